@@ -29,9 +29,13 @@
 #pragma link C++ class reco::XYPositionFinder+;
 #pragma link C++ class reco::EndOfEventAnalysis+;
 
+// WFD5 output
+#pragma link C++ class reco::PackedTraces+;
+
 // WFD5 services
 #pragma link C++ class reco::TemplateLoaderService+;
 #pragma link C++ class reco::TemplateFitterService+;
 #pragma link C++ class reco::ChannelMapService+;
+#pragma link C++ class reco::RFPhaseTrackerService+;
 
 #endif
@@ -0,0 +1,37 @@
+#ifndef COLLECTIONHANDLE_HH
+#define COLLECTIONHANDLE_HH
+
+#include <cstddef>
+#include <string>
+
+namespace reco {
+
+    class EventStore;
+
+    // A collection of the EventStore, looked up by name once (in a stage's Configure) instead of on
+    // every event. The handle is an index into the store's table of collections, so it works on every
+    // replica of the store it was made with. T is the element type, as for EventStore::get.
+    template <typename T>
+    class CollectionHandle {
+    public:
+        CollectionHandle() = default;
+
+        bool IsValid() const { return index_ != kInvalid; }
+        size_t GetIndex() const { return index_; }
+
+        // Name the collection is stored under (after following aliases)
+        const std::string& GetLabel() const { return label_; }
+
+    private:
+        friend class EventStore;
+
+        CollectionHandle(size_t index, const std::string& label) : index_(index), label_(label) {}
+
+        static constexpr size_t kInvalid = static_cast<size_t>(-1);
+
+        size_t index_ = kInvalid;
+        std::string label_;
+    };
+} //namespace reco
+
+#endif // COLLECTIONHANDLE_HH
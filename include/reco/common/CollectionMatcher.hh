@@ -0,0 +1,33 @@
+#ifndef COLLECTIONMATCHER_HH
+#define COLLECTIONMATCHER_HH
+
+#include <regex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace reco {
+
+    // A list of collection name patterns, compiled once (e.g. the Output block's drop and keep lists).
+    // A pattern is either a glob, where '*' matches any run of characters and '?' any single one,
+    // or "regex:" followed by an ECMAScript regular expression that must match the whole name.
+    class CollectionMatcher {
+    public:
+        CollectionMatcher() = default;
+        explicit CollectionMatcher(const std::vector<std::string>& patterns);
+
+        // Whether any of the patterns matches the name
+        bool Matches(const std::string& name) const;
+
+        bool empty() const { return exact_.empty() && globs_.empty() && regexes_.empty(); }
+
+        static bool MatchesGlob(const std::string& pattern, const std::string& text);
+
+    private:
+        std::unordered_set<std::string> exact_; // patterns without wildcards
+        std::vector<std::string> globs_;
+        std::vector<std::regex> regexes_;
+    };
+} //namespace reco
+
+#endif // COLLECTIONMATCHER_HH
@@ -0,0 +1,36 @@
+#ifndef EVENTBATCH_HH
+#define EVENTBATCH_HH
+
+#include <TClass.h>
+#include <TClonesArray.h>
+
+namespace reco {
+
+    // A collection kept by the EventStore in a layout suited to the stages (e.g. columns), instead of
+    // as a TClonesArray of data products. It is turned into a TClonesArray of its element class only
+    // when the objects are needed: a stage asking for the collection with EventStore::get, or the
+    // OutputManager writing it. A "view" batch just wraps a TClonesArray that already exists.
+    class EventBatch {
+    public:
+        virtual ~EventBatch() = default;
+
+        // Class of the objects Materialize creates
+        virtual TClass* GetElementClass() const = 0;
+
+        // Append one object per entry to out
+        virtual void Materialize(TClonesArray& out) const = 0;
+
+        // Called at the end of each event
+        virtual void Clear() = 0;
+
+        bool IsView() const { return view_; }
+
+    protected:
+        void SetView(bool view) { view_ = view; }
+
+    private:
+        bool view_ = false;
+    };
+} //namespace reco
+
+#endif // EVENTBATCH_HH
@@ -1,20 +1,29 @@
 #ifndef EVENTSTORE_HH
 #define EVENTSTORE_HH
 
+#include <functional>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <type_traits>
 
 #include <TClonesArray.h>
 
 #include <data_products/common/DataProduct.hh>
 #include <data_products/wfd5/WFD5WaveformFit.hh>
 
+#include "reco/common/CollectionHandle.hh"
+#include "reco/common/EventBatch.hh"
+
 namespace reco {
 
+    // Stages that RecoManager runs concurrently share one EventStore: creating collections, batches and
+    // handles, and materializing batches, take the store's mutex, while the handle lookups stay lock-free.
     class EventStore {
     public:
         EventStore() = default;
@@ -23,31 +32,23 @@ namespace reco {
         // get or create a TClonesArray for a specific reco_label and data_label
         template <typename T>
         TClonesArray* getOrCreate(const std::string& reco_label, const std::string& data_label) {
+            return GetOrCreateBuffer<T>(GetLabel(reco_label, data_label));
+        }
 
-            // Check that data_label and reco_label have no underscores
-            if (data_label.find('_') != std::string::npos || reco_label.find('_') != std::string::npos) {
-                throw std::runtime_error("Data label or Reco label cannot contain underscores: " + data_label + ", " + reco_label);
+        // Get a collection by name; a batch stored under this name is materialized first
+        template <typename T>
+        TClonesArray* get(const std::string& reco_label, const std::string& data_label) {
+            std::string label = GetLabel(reco_label, data_label);
+            const EventBatch* batch = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = batches_.find(label);
+                if (it != batches_.end() && !it->second->IsView()) batch = it->second.get();
             }
-            std::string label = reco_label + "_" + data_label;
-
-            // Check if buffer already exists
-            auto it = buffers_.find(label);
-            if (it != buffers_.end()) {
-                // Check type matches T
-                const char* className = it->second->GetClass()->GetName();
-                if (std::string(className) != T::Class()->GetName()) {
-                    throw std::runtime_error("Type mismatch for label " + label + 
-                                            ": requested " + T::Class()->GetName() + 
-                                            ", found " + className);
-                }
-                return it->second;
+            if (batch) {
+                return Materialize(label, *batch);
             }
-            // If not, create a new TClonesArray for the type T
-            TClonesArray* arr = new TClonesArray(T::Class()->GetName());
-            buffers_[label] = arr;
-            bufferKeys_.push_back(label);
-            std::cout << "-> reco::EventStore: Created TClonesArray for '" << label << "'." << std::endl;
-            return arr;
+            return static_cast<const EventStore*>(this)->get<T>(reco_label, data_label);
         }
 
         // Get a collection by name const
@@ -58,7 +59,8 @@ namespace reco {
             if (data_label.find('_') != std::string::npos || reco_label.find('_') != std::string::npos) {
                 throw std::runtime_error("Data label or Reco label cannot contain underscores: " + data_label + ", " + reco_label);
             }
-            std::string label = reco_label + "_" + data_label;
+            std::string label = Resolve(reco_label + "_" + data_label);
+            std::lock_guard<std::mutex> lock(mutex_);
             auto it = buffers_.find(label);
             if (it == buffers_.end()) {
                 throw std::runtime_error("Data product not found: " + label);
@@ -96,6 +98,118 @@ namespace reco {
 
         }
 
+        // Handle to the collection of T stored under this name, for use with the get/getOrCreate overloads
+        // below. Made once, in Configure; the collection itself need not exist yet.
+        template <typename T>
+        CollectionHandle<T> getHandle(const std::string& reco_label, const std::string& data_label) {
+            std::string label = GetLabel(reco_label, data_label);
+            std::string className = std::remove_const_t<T>::Class()->GetName();
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto [it, inserted] = slotIndex_.emplace(label, slots_.size());
+            if (inserted) {
+                CollectionSlot slot;
+                auto buffer = buffers_.find(label);
+                if (buffer != buffers_.end()) slot.buffer = buffer->second;
+                auto batch = batches_.find(label);
+                if (batch != batches_.end()) slot.batch = batch->second.get();
+                slots_.push_back(slot);
+                slotClasses_.push_back(className);
+            } else if (slotClasses_[it->second] != className) {
+                throw std::runtime_error("Type mismatch for label " + label + ": requested " + className +
+                                         ", found " + slotClasses_[it->second]);
+            }
+            return CollectionHandle<T>(it->second, label);
+        }
+
+        // get or create the TClonesArray of a handle
+        template <typename T>
+        TClonesArray* getOrCreate(const CollectionHandle<T>& handle) {
+            CollectionSlot& slot = GetSlot(handle);
+            return slot.buffer ? slot.buffer : GetOrCreateBuffer<std::remove_const_t<T>>(handle.GetLabel());
+        }
+
+        // Get the collection of a handle; a batch stored under this name is materialized first
+        template <typename T>
+        TClonesArray* get(const CollectionHandle<T>& handle) {
+            const CollectionSlot& slot = GetSlot(handle);
+            if (slot.batch && !slot.batch->IsView()) {
+                return Materialize(handle.GetLabel(), *slot.batch);
+            }
+            return static_cast<const EventStore*>(this)->get(handle);
+        }
+
+        // Get the collection of a handle const
+        template <typename T>
+        TClonesArray* get(const CollectionHandle<T>& handle) const {
+            const CollectionSlot& slot = GetSlot(handle);
+            if (!slot.buffer) {
+                throw std::runtime_error("Data product not found: " + handle.GetLabel());
+            }
+            return slot.buffer;
+        }
+
+        // get or create the batch of type T (derived from EventBatch) for a specific reco_label and data_label
+        template <typename T>
+        T& getOrCreateBatch(const std::string& reco_label, const std::string& data_label) {
+            return GetOrCreateBatch<T>(GetLabel(reco_label, data_label));
+        }
+
+        // get or create the batch of type B (derived from EventBatch) of a handle
+        template <typename B, typename T>
+        B& getOrCreateBatch(const CollectionHandle<T>& handle) {
+            EventBatch* batch = GetSlot(handle).batch;
+            if (batch) {
+                B* typed = dynamic_cast<B*>(batch);
+                if (!typed) {
+                    throw std::runtime_error("Type mismatch for batch " + handle.GetLabel());
+                }
+                return *typed;
+            }
+            return GetOrCreateBatch<B>(handle.GetLabel());
+        }
+
+        // The batch of type B stored under a handle, or nullptr
+        template <typename B, typename T>
+        B* findBatch(const CollectionHandle<T>& handle) const {
+            return dynamic_cast<B*>(GetSlot(handle).batch);
+        }
+
+        // The batch of type T stored under this name, or nullptr
+        template <typename T>
+        T* findBatch(const std::string& reco_label, const std::string& data_label) const {
+            auto it = batches_.find(GetLabel(reco_label, data_label));
+            return it == batches_.end() ? nullptr : dynamic_cast<T*>(it->second.get());
+        }
+
+        // Materialize the (non-view) batches whose name passes the filter, e.g. the ones being written out
+        void MaterializeBatches(const std::function<bool(const std::string&)>& wanted);
+
+        // A batch changed after it may have been materialized (by an in-place stage): the next get
+        // or the output materializes it again
+        template <typename T>
+        void MarkModified(const CollectionHandle<T>& handle) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            materialized_.erase(handle.GetLabel());
+        }
+
+        // Held by a stage while it sets up a batch that stages running at the same time may share (e.g. a view)
+        std::mutex& GetSetupMutex() const { return setupMutex_; }
+
+        // Make reco_label/data_label another name for the collection target_reco/target_data, for stages
+        // that modify their input in place. Aliases are set up at configure time and hold no data,
+        // so the OutputManager never writes them.
+        void alias(const std::string& reco_label, const std::string& data_label,
+                   const std::string& target_reco, const std::string& target_data);
+
+        // The name a collection is stored under, after following aliases
+        std::string GetLabel(const std::string& reco_label, const std::string& data_label) const {
+            return Resolve(MakeLabel(reco_label, data_label));
+        }
+
+        const std::map<std::string, std::string>& GetAliases() const {
+            return aliases_;
+        }
+
         void put_odb(std::shared_ptr<dataProducts::DataProduct> odb) {
             if (odb_) {
                 throw std::runtime_error("ODB data product already exists");
@@ -147,6 +261,30 @@ namespace reco {
             return splines_;
         }
 
+        // Other objects written with the histograms at the end of the job (e.g. a TTree of summaries)
+        void putObject(const std::string& name, std::shared_ptr<TObject> object) {
+            if (objects_.count(name)) {
+                std::cerr << "Warning: Object with name " << name << " already exists. Overwriting.\n";
+            }
+            std::cout << "-> reco::EventStore: Created object '" << name << "' in the event store." << std::endl;
+            objects_[name] = std::move(object);
+        }
+
+        const std::map<std::string, std::shared_ptr<TObject>>& GetAllObjects() const {
+            return objects_;
+        }
+
+        // Work left for the end of the job (RecoManager registers the EndOfJob of its stages).
+        // RunEndOfJob runs it once; OutputManager::WriteHistograms calls it before writing.
+        void OnEndOfJob(std::function<void(EventStore&)> hook) {
+            endOfJobHooks_.push_back(std::move(hook));
+        }
+        void RunEndOfJob() {
+            auto hooks = std::move(endOfJobHooks_);
+            endOfJobHooks_.clear();
+            for (auto& hook : hooks) hook(*this);
+        }
+
         // Run / Subrun information
         void SetRunSubrun(int run, int subrun) {
             run_ = run;
@@ -159,14 +297,129 @@ namespace reco {
             for (auto& [key, buffer] : buffers_) {
                 buffer->Clear("C");
             }
+            for (auto& [key, batch] : batches_) {
+                batch->Clear();
+            }
+            materialized_.clear();
         }
 
+        // Make an EventStore for a worker thread: it shares the run info, odb and splines,
+        // gets its own (empty) copy of every histogram and creates its own collections.
+        std::unique_ptr<EventStore> MakeReplica() const;
+
+        // What a replica takes over from the main store with every event (see ParallelEventProcessor::Submit),
+        // so that a run change or an ODB put into the main store during the job reaches the workers
+        struct Conditions {
+            int run = 0;
+            int subrun = 0;
+            std::shared_ptr<dataProducts::DataProduct> odb;
+        };
+        Conditions GetConditions() const { return {run_, subrun_, odb_}; }
+        void SetConditions(const Conditions& conditions) {
+            run_ = conditions.run;
+            subrun_ = conditions.subrun;
+            odb_ = conditions.odb;
+        }
+
+        // Add the histograms of a replica into this store's histograms
+        void MergeHistograms(const EventStore& replica);
+
     private:
+        static std::string MakeLabel(const std::string& reco_label, const std::string& data_label) {
+            if (data_label.find('_') != std::string::npos || reco_label.find('_') != std::string::npos) {
+                throw std::runtime_error("Data label or Reco label cannot contain underscores: " + data_label + ", " + reco_label);
+            }
+            return reco_label + "_" + data_label;
+        }
+
+        // What the handle with the same index refers to in this store
+        struct CollectionSlot {
+            TClonesArray* buffer = nullptr;
+            EventBatch* batch = nullptr;
+        };
+
+        template <typename T>
+        CollectionSlot& GetSlot(const CollectionHandle<T>& handle) {
+            return slots_.at(handle.GetIndex());
+        }
+
+        template <typename T>
+        const CollectionSlot& GetSlot(const CollectionHandle<T>& handle) const {
+            return slots_.at(handle.GetIndex());
+        }
+
+        // The slot of a label that has a handle, or nullptr
+        CollectionSlot* FindSlot(const std::string& label) {
+            auto it = slotIndex_.find(label);
+            return it == slotIndex_.end() ? nullptr : &slots_[it->second];
+        }
+
+        template <typename T>
+        TClonesArray* GetOrCreateBuffer(const std::string& label) {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // Check if buffer already exists
+            auto it = buffers_.find(label);
+            if (it != buffers_.end()) {
+                // Check type matches T
+                const char* className = it->second->GetClass()->GetName();
+                if (std::string(className) != T::Class()->GetName()) {
+                    throw std::runtime_error("Type mismatch for label " + label + 
+                                            ": requested " + T::Class()->GetName() + 
+                                            ", found " + className);
+                }
+                return it->second;
+            }
+            // If not, create a new TClonesArray for the type T
+            TClonesArray* arr = new TClonesArray(T::Class()->GetName());
+            buffers_[label] = arr;
+            bufferKeys_.push_back(label);
+            if (auto* slot = FindSlot(label)) slot->buffer = arr;
+            std::cout << "-> reco::EventStore: Created TClonesArray for '" << label << "'." << std::endl;
+            return arr;
+        }
+
+        template <typename T>
+        T& GetOrCreateBatch(const std::string& label) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = batches_.find(label);
+            if (it == batches_.end()) {
+                it = batches_.emplace(label, std::make_unique<T>()).first;
+                batchKeys_.push_back(label);
+                if (auto* slot = FindSlot(label)) slot->batch = it->second.get();
+                std::cout << "-> reco::EventStore: Created batch for '" << label << "'." << std::endl;
+            }
+            T* batch = dynamic_cast<T*>(it->second.get());
+            if (!batch) {
+                throw std::runtime_error("Type mismatch for batch " + label);
+            }
+            return *batch;
+        }
+
+        std::string Resolve(const std::string& label) const {
+            auto it = aliases_.find(label);
+            return it == aliases_.end() ? label : it->second;
+        }
+
+        // Fill the TClonesArray of this label from its batch (once per event)
+        TClonesArray* Materialize(const std::string& label, const EventBatch& batch);
+
         std::unordered_map<std::string, TClonesArray*> buffers_; //buffers for the data product collections
         std::vector<std::string> bufferKeys_; //keys for the data products (need to know insertion order for TRefs)
         std::shared_ptr<dataProducts::DataProduct> odb_;  // ODB data product, if any
         std::map<std::string, std::shared_ptr<TH1>> histograms_; //histograms
         std::map<std::string, std::shared_ptr<dataProducts::SplineHolder>> splines_; //splines
+        std::map<std::string, std::shared_ptr<TObject>> objects_; //other end-of-job output
+        std::vector<std::function<void(EventStore&)>> endOfJobHooks_; //see OnEndOfJob
+        std::unordered_map<std::string, std::unique_ptr<EventBatch>> batches_; //batched collections
+        std::vector<std::string> batchKeys_; //batch labels in creation order
+        std::unordered_set<std::string> materialized_; //batches already materialized this event
+        std::map<std::string, std::string> aliases_; //alias label -> label the collection is stored under
+        std::vector<CollectionSlot> slots_; //collections of the handles, by handle index
+        std::unordered_map<std::string, size_t> slotIndex_; //label -> handle index
+        std::vector<std::string> slotClasses_; //element class of each handle index
+        mutable std::mutex mutex_; //guards the maps above while stages run concurrently
+        mutable std::mutex setupMutex_; //see GetSetupMutex
 
         int run_; // run number
         int subrun_; // subrun number
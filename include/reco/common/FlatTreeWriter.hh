@@ -0,0 +1,66 @@
+#ifndef FLATTREEWRITER_HH
+#define FLATTREEWRITER_HH
+
+#include <string>
+#include <vector>
+
+#include <TClass.h>
+#include <TTree.h>
+
+#include "reco/common/EventStore.hh"
+
+namespace reco {
+
+    // Writes chosen fields of the objects of one collection as plain columns of a TTree of their own,
+    // one entry per object, so they can be read without the reco dictionary.
+    // Besides the fields, every entry has the run, subrun and the entry of the event in the main tree.
+    // The fields are found by name through the collection's ROOT dictionary; supported are the usual
+    // scalar types and std::vector<int/short/float/double>.
+    class FlatTreeWriter {
+    public:
+        // The tree is created in the current ROOT directory
+        FlatTreeWriter(const std::string& treeName, const std::string& collection, const std::vector<std::string>& fields);
+
+        FlatTreeWriter(const FlatTreeWriter&) = delete;
+        FlatTreeWriter& operator=(const FlatTreeWriter&) = delete;
+
+        const std::string& GetCollection() const { return collection_; }
+
+        // Add one entry per object of the collection in this EventStore
+        void Fill(const EventStore& eventStore, Long64_t event);
+
+        void Write();
+
+    private:
+        enum class Kind { kInt, kUInt, kShort, kLong64, kULong64, kFloat, kDouble, kBool,
+                          kVectorInt, kVectorShort, kVectorFloat, kVectorDouble };
+
+        struct Column {
+            std::string field;
+            Kind kind = Kind::kDouble;
+            Long_t offset = 0;  // of the field in the object
+            size_t size = 0;    // of a scalar field
+            alignas(8) unsigned char value[8] = {};
+            std::vector<int> vectorInt;
+            std::vector<short> vectorShort;
+            std::vector<float> vectorFloat;
+            std::vector<double> vectorDouble;
+        };
+
+        // Find the fields in the element class and create the branches
+        void Bind(TClass* elementClass);
+
+        static Kind ParseKind(const std::string& typeName, size_t& size, char& leafType);
+
+        std::string collection_;
+        std::vector<Column> columns_;
+        TTree* tree_;
+        bool bound_ = false;
+
+        Int_t run_ = 0;
+        Int_t subrun_ = 0;
+        Long64_t event_ = 0;
+    };
+} //namespace reco
+
+#endif // FLATTREEWRITER_HH
@@ -0,0 +1,50 @@
+#ifndef NAMETABLE_HH
+#define NAMETABLE_HH
+
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+namespace reco {
+
+    // Interns names as small integer ids, so per-object tests are integer compares and the
+    // names themselves are only looked up for output or printing.
+    // Filled at configure time; lookups are safe from several threads once it is no longer changed.
+    class NameTable {
+    public:
+        using Id = uint16_t;
+        static constexpr Id kNoName = UINT16_MAX;
+
+        // Id of a name, adding it if it is new
+        Id Intern(const std::string& name) {
+            auto it = ids_.find(name);
+            if (it != ids_.end()) return it->second;
+            if (names_.size() >= kNoName) {
+                throw std::runtime_error("NameTable: too many names");
+            }
+            Id id = static_cast<Id>(names_.size());
+            names_.push_back(name);
+            ids_.emplace(name, id);
+            return id;
+        }
+
+        // Id of a name, or kNoName if it was never interned
+        Id Find(const std::string& name) const {
+            auto it = ids_.find(name);
+            return it == ids_.end() ? kNoName : it->second;
+        }
+
+        // The string stays at the same address for the lifetime of the table
+        const std::string& GetName(Id id) const { return names_.at(id); }
+
+        size_t size() const { return names_.size(); }
+
+    private:
+        std::deque<std::string> names_;
+        std::unordered_map<std::string, Id> ids_;
+    };
+}
+
+#endif // NAMETABLE_HH
@@ -3,6 +3,9 @@
 
 #include <string>
 #include <map>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <memory>
 #include <iostream>
@@ -15,8 +18,10 @@
 
 #include <data_products/common/RecoConfig.hh>
 
+#include "reco/common/CollectionMatcher.hh"
 #include "reco/common/EventStore.hh"
 #include "reco/common/ConfigHolder.hh"
+#include "reco/common/FlatTreeWriter.hh"
 
 using json = nlohmann::json;
 
@@ -30,29 +35,94 @@ namespace reco {
         void Configure(std::shared_ptr<const ConfigHolder> configHolder);
 
         // Write event data from EventStore to tree
-        void FillEvent(const EventStore& eventStore);
+        void FillEvent(EventStore& eventStore);
+
+        // Turn the batches that will be written into collections (FillEvent does this too).
+        // Only reads the configuration, so worker threads may call it on their own EventStore.
+        void MaterializeForOutput(EventStore& eventStore) const;
+
+        // Whether a collection is dropped from the output: it matches the drop list and not the keep list.
+        // The answer is remembered per name, so the patterns are only matched once.
+        bool IsDropped(const std::string& collName) const;
+
+        // Whether FillEvent should run on a writer thread of its own (see ParallelEventProcessor)
+        bool IsAsync() const { return asyncWriter_; }
+
+        // Number of reconstructed events that may wait for the writer thread
+        int GetWriterQueueDepth() const { return writerQueueDepth_; }
 
         // Virtual method for writing the ODB
         virtual void WriteODB(const EventStore& eventStore) = 0;
-        void WriteHistograms(const EventStore& store);
+        // Write the histograms and other end-of-job objects, after running the EndOfJob of the stages
+        void WriteHistograms(EventStore& store);
         void WriteSplines(const EventStore& store);
 
-        bool MatchesWildcard(const std::string& pattern, const std::string& text);
-        bool StartsWith(const std::string& str, const std::string& prefix);
-        bool EndsWith(const std::string& str, const std::string& suffix);
+        static bool MatchesWildcard(const std::string& pattern, const std::string& text);
+        static bool StartsWith(const std::string& str, const std::string& prefix);
+        static bool EndsWith(const std::string& str, const std::string& suffix);
 
     protected:
 
         // Helper to create branch if missing
         void CreateBranchIfMissing(const std::string& name, TClonesArray* buffer);
 
+        // Hooks for the data formats: read their settings from the 'Output' block, set up a new
+        // branch, and change the objects just before the tree is filled (and undo it after)
+        virtual void ConfigureOutput(const nlohmann::json& /*outputConfig*/) {}
+        virtual void BranchCreated(const std::string& /*name*/, TClonesArray* /*buffer*/) {}
+        virtual void PrepareFill(const EventStore& /*eventStore*/) {}
+        virtual void FinishFill() {}
+
+        // Point the branches at the collections of this EventStore
+        void BindStore(const EventStore& eventStore);
+
+        // Compression and basket size for the branches of the collections matching a pattern.
+        // Settings left at -1 are taken from the file (compression) or ROOT's default (basket size).
+        struct BranchRule {
+            CollectionMatcher match;
+            int compressionAlgorithm = -1;
+            int compressionLevel = -1;
+            int basketSize = -1;
+        };
+
+        // The first rule whose pattern matches the collection, or nullptr
+        const BranchRule* FindBranchRule(const std::string& name) const;
+
         // Collections to not write to the tree
         std::vector<std::string> dropList_; 
 
+        // Collections to write even if they match the drop list
+        std::vector<std::string> keepList_;
+
+        CollectionMatcher dropMatcher_;
+        CollectionMatcher keepMatcher_;
+        mutable std::unordered_map<std::string, bool> dropped_; // IsDropped results by collection name
+        mutable std::mutex droppedMutex_;
+
+        std::vector<BranchRule> branchRules_;
+
+        // Trees of plain columns, written next to the main tree (and even for dropped collections)
+        std::vector<std::unique_ptr<FlatTreeWriter>> flatTrees_;
+        std::unordered_set<std::string> flatCollections_;
+
+        // The EventStore the branches point at, and how many collections it had then. The branches only
+        // need repointing when another store is filled or the store has created a new collection.
+        const EventStore* boundStore_ = nullptr;
+        size_t boundKeys_ = 0;
+
+        // Pointer slots the branches read from; repointed when a different EventStore is filled
+        std::map<std::string, TClonesArray*> branchBuffers_;
+
+        // Empty stand-ins for collections an EventStore has not (yet) created
+        std::map<std::string, std::unique_ptr<TClonesArray>> emptyBuffers_;
+
         std::unique_ptr<TFile> file_;
         TTree* tree_;
         int compressionLevel_;
         int compressionAlgorithm_;
+        bool asyncWriter_ = false;
+        int writerQueueDepth_ = 2;
+        int compressionThreads_ = 0;
     };
 } //namespace reco
 
@@ -0,0 +1,94 @@
+#ifndef PARALLELEVENTPROCESSOR_HH
+#define PARALLELEVENTPROCESSOR_HH
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "reco/common/RecoManager.hh"
+#include "reco/common/ServiceManager.hh"
+#include "reco/common/OutputManager.hh"
+#include "reco/common/EventStore.hh"
+
+namespace reco {
+
+    // Runs the RecoPath over several events at once.
+    // Worker threads pull whole events from a bounded queue, load each one into a private
+    // EventStore replica and run every stage on it. A single writer thread hands the finished
+    // replicas to the OutputManager in submission order, so the tree keeps the event order.
+    // With nThreads = 1 (the default) Submit() simply runs the event inline on the main EventStore,
+    // unless the OutputManager is asynchronous: then the event is reconstructed inline on a replica
+    // and only the writing is left to the writer thread.
+    // It replaces the event loop of the application linking against the library (reco_bench is the
+    // only user within this repository); nThreads has no effect on a loop that calls RecoManager::Run directly.
+    class ParallelEventProcessor {
+    public:
+        // Puts the unpacked collections of one event into an EventStore (called on a worker thread)
+        using EventLoader = std::function<void(EventStore&)>;
+
+        ParallelEventProcessor(RecoManager& recoManager, const ServiceManager& serviceManager,
+                               OutputManager& outputManager, EventStore& eventStore);
+        ~ParallelEventProcessor();
+
+        ParallelEventProcessor(const ParallelEventProcessor&) = delete;
+        ParallelEventProcessor& operator=(const ParallelEventProcessor&) = delete;
+
+        // Queue one event (blocks while the queue is full). The event is reconstructed with the run,
+        // subrun and ODB the main EventStore has at this call.
+        void Submit(EventLoader loader);
+
+        // Wait until every queued event is written, merge the replica histograms into the main EventStore
+        // and call RecoManager::EndOfJob
+        void Finish();
+
+        int GetNThreads() const { return nThreads_; }
+
+    private:
+        struct Job {
+            uint64_t seq;
+            EventLoader loader;
+            EventStore::Conditions conditions; // of the main store when the event was submitted
+        };
+
+        void SubmitInline(EventLoader loader);
+        void WorkerLoop();
+        void WriterLoop();
+        void RethrowIfFailed();
+
+        RecoManager& recoManager_;
+        const ServiceManager& serviceManager_;
+        OutputManager& outputManager_;
+        EventStore& eventStore_;
+
+        int nThreads_;
+        size_t queueDepth_;
+
+        std::vector<std::unique_ptr<EventStore>> replicas_;
+        std::vector<EventStore*> freeStores_;
+        std::deque<Job> jobs_;
+        std::map<uint64_t, EventStore*> completed_; // reconstructed events waiting for their turn to be written
+
+        uint64_t nSubmitted_ = 0;
+        uint64_t nextToWrite_ = 0;
+        bool stopping_ = false;
+        bool finished_ = false;
+        std::exception_ptr failure_;
+
+        std::mutex mutex_;
+        std::condition_variable workCv_;   // a job and a free replica are available
+        std::condition_variable spaceCv_;  // the job queue has room
+        std::condition_variable writerCv_; // the next event in order is reconstructed
+
+        std::vector<std::thread> workers_;
+        std::thread writer_;
+    };
+} //namespace reco
+
+#endif // PARALLELEVENTPROCESSOR_HH
@@ -3,8 +3,11 @@
 #include <TSpline.h>
 #include <Math/Minimizer.h>
 #include <Math/Factory.h>
-#include <Math/Functor.h>
+#include <Math/IFunction.h>
 #include <vector>
+#include <cmath>
+#include <algorithm>
+#include <string>
 #include <iostream>
 #include <limits>
 #include <iomanip>
@@ -13,6 +16,8 @@
 #include "TRef.h"
 // #include <omp.h>
 #include "data_products/wfd5/CubicSpline.hh"
+#include "reco/common/SplineSegments.hh"
+#include "reco/common/TemplateTable.hh"
 #include <nlohmann/json.hpp>
 
 
@@ -35,23 +40,39 @@ public:
         splines[1] = spline2;
 
         if (debug) std::cout << "Creating Minimizer..." << std::endl;
-        minimizer = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
-        // minimizer = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Minimize");
-        if (!minimizer)
-        {
-            throw std::runtime_error("Error: Minimzer not created!");
-        }
-        if (debug) std::cout << "   -> minimizer: " << minimizer << std::endl;
-        
-        minimizer->SetStrategy(0);
-        minimizer->SetMaxFunctionCalls(1000);
-        minimizer->SetTolerance(1e-6);
-        // minimizer->SetTolerance(1e-3);
-        minimizer->SetPrintLevel(0);
+        createMinimizer();
         if (debug) std::cout << "   -> TemplateFit initialized" << std::endl;
 
     }
 
+    // Copy the configuration and the (shared, read-only) templates of another fitter.
+    // The copy gets its own minimizer and empty per-fit state, so it can fit on another thread.
+    TemplateFit(const TemplateFit& other)
+        : minimumAmplitude(other.minimumAmplitude), maximumAmplitude(other.maximumAmplitude), timeBounds(other.timeBounds),
+          maxPulses(other.maxPulses), chi2Threshold(other.chi2Threshold), debug(other.debug), timeout(false),
+          single_spline_only(other.single_spline_only), restricted_chi2_min(other.restricted_chi2_min),
+          restricted_chi2_max(other.restricted_chi2_max), timeout_limit(other.timeout_limit),
+          amp_scale_factor(other.amp_scale_factor), max_val_without_clipping(other.max_val_without_clipping),
+          min_val_without_clipping(other.min_val_without_clipping), is_seeded(other.is_seeded),
+          seeded_extra_leeway(other.seeded_extra_leeway), use_variable_projection(other.use_variable_projection),
+          use_template_table(other.use_template_table), full_chi2_final_fit(other.full_chi2_final_fit) {
+        splines[0] = other.splines[0];
+        splines[1] = other.splines[1];
+        tsplines[0] = other.tsplines[0];
+        tsplines[1] = other.tsplines[1];
+        tables[0] = other.tables[0];
+        tables[1] = other.tables[1];
+        segments[0] = other.segments[0];
+        segments[1] = other.segments[1];
+        createMinimizer();
+    }
+
+    TemplateFit& operator=(const TemplateFit&) = delete;
+
+    ~TemplateFit() {
+        delete minimizer;
+    }
+
     void SetValueFromConfig(nlohmann::json config)
     {
         // set to default values if no json key is found
@@ -73,6 +94,9 @@ public:
             config.value("restricted_chi2_min", -100),
             config.value("restricted_chi2_max",  100)
         );
+        SetFitEngine( config.value("fitEngine", std::string("migrad")) );
+        SetTemplateEvaluation( config.value("templateEvaluation", std::string("spline")) );
+        SetFullChi2FinalFit( config.value("fullChi2FinalFit", false) );
 
     }
 
@@ -82,6 +106,30 @@ public:
     void SetMaxPulses(double val) { maxPulses = val; }
     void SetChi2Threshold(double val) { chi2Threshold = val; }
 
+    // "migrad": Migrad over pedestal, amplitudes and times
+    // "varpro":  pedestal and amplitudes solved linearly for each set of times, Migrad over the times only
+    void SetFitEngine(const std::string& engine)
+    {
+        if (engine == "migrad") use_variable_projection = false;
+        else if (engine == "varpro") use_variable_projection = true;
+        else throw std::runtime_error("TemplateFit: Unknown fitEngine '" + engine + "' (expected 'migrad' or 'varpro')");
+    }
+
+    // "spline": evaluate the fitter::CubicSpline directly (the default)
+    // "table":  interpolate the oversampled tables from the TemplateLoaderService (falls back to the spline if none is set).
+    //           They match the spline except within the grid intervals that contain a knot.
+    void SetTemplateEvaluation(const std::string& evaluation)
+    {
+        if (evaluation == "table") use_template_table = true;
+        else if (evaluation == "spline") use_template_table = false;
+        else throw std::runtime_error("TemplateFit: Unknown templateEvaluation '" + evaluation + "' (expected 'table' or 'spline')");
+    }
+
+    // Fit the whole trace in the final minimization instead of the samples within
+    // [restricted_chi2_min, restricted_chi2_max] of each pulse. Off by default, which keeps the
+    // results of before; both engines follow it.
+    void SetFullChi2FinalFit(bool full) { full_chi2_final_fit = full; }
+
     void SetSeeded(bool seeded, bool lee)
     {
         is_seeded = seeded;
@@ -106,6 +154,17 @@ public:
         tsplines[i] = sp;
     }
 
+    void SetTemplateTable(const reco::TemplateTable* table, int i)
+    {
+        tables[i] = table;
+    }
+
+    // Coefficients of spline i, which give the template slope for the analytic gradient
+    void SetSplineSegments(const reco::SplineSegments* spline_segments, int i)
+    {
+        segments[i] = spline_segments;
+    }
+
     void setFitResult(dataProducts::WaveformFit* w)
     {
 
@@ -180,6 +239,7 @@ public:
             std::cout << "Trace added with size: " << trace.size() << ", timeOffset: " << timeOffset << "\n";
         }
         fittedTrace.resize(xs.size());
+        cacheTraceSums();
     }
 
     double model(const std::vector<double>& xs, const std::vector<double>& p, std::vector<double>& fittedTrace, bool fullModelEvaluation = true) {
@@ -194,41 +254,65 @@ public:
             }
             double amp = p[1 + n * 2];
             double t = p[2 + n * 2];
-            for (size_t i = 0; i < xs.size(); ++i) {
-                double xi = xs[i] - t;
-
-                // this is a bad idea in general, but may be good for intermediate steps
-                if ((!fullModelEvaluation) && ((xi > restricted_chi2_max) || (xi < restricted_chi2_min))) continue; //this saves time by only evaluating the spline very near the peak
-
-                fittedTrace[i] += amp * (*splines[whichTemplate])(xi) ;
+            size_t begin = 0, end = xs.size();
+            if (!fullModelEvaluation) {
+                // this is a bad idea in general, but may be good for intermediate steps: only evaluate the spline very near the peak
+                begin = std::lower_bound(xs.begin(), xs.end(), t + restricted_chi2_min) - xs.begin();
+                end = std::upper_bound(xs.begin() + begin, xs.end(), t + restricted_chi2_max) - xs.begin();
+            }
+            for (size_t i = begin; i < end; ++i) {
+                fittedTrace[i] += amp * templateValue(whichTemplate, xs[i] - t) ;
             }
         }
         return 0.0; // Dummy return for now
     }
 
     double abbreviated_chi2(const std::vector<double>& p) {
-        model(xs, p, fittedTrace, false); // only evaluate near the peak
-        double sum = 0.0;
-        for (size_t i = 0; i < xs.size(); ++i) {
-            double diff = ys[i] - fittedTrace[i];
-            // sum += diff * diff/ (yerrs[i] * yerrs[i]);
-            sum += diff * diff; // assumes uniform bin errors
-        }
-        return sum;
+        return evaluateChi2(p.data(), p.size(), false); // only evaluate near the peak
     }
 
     double chi2(const std::vector<double>& p) {
-        model(xs, p, fittedTrace, true);
-        double sum = 0.0;
-        for (size_t i = 0; i < xs.size(); ++i) {
-            double diff = ys[i] - fittedTrace[i];
-            // sum += diff * diff/ (yerrs[i] * yerrs[i]);
-            sum += diff * diff; // assumes uniform bin errors
+        return evaluateChi2(p.data(), p.size(), true);
+    }
+
+    // chi2 straight from the minimizer's parameter array, optionally with its analytic gradient.
+    // With p = [ped, A1, t1, A2, t2, ...] and r_i = y_i - f(x_i):
+    //   dchi2/dped = -2 sum r_i,  dchi2/dA_n = -2 sum r_i S_n(x_i - t_n),  dchi2/dt_n = 2 A_n sum r_i S'_n(x_i - t_n)
+    // Uses only member scratch space, so nothing is allocated once the vectors have grown to size.
+    double evaluateChi2(const double* p, size_t nPar, bool fullModelEvaluation, double* grad = nullptr) {
+        const size_t nSamples = xs.size();
+        const size_t nPulses = (nPar - 1) / 2;
+        prepareTemplateScratch(nPulses, grad != nullptr);
+        for (size_t n = 0; n < nPulses; ++n) {
+            evaluatePulse(n, p[2 + n * 2], fullModelEvaluation, grad != nullptr);
+        }
+        fillFittedTrace(p[0], nPulses, fullModelEvaluation, [&](size_t n) { return p[1 + n * 2]; });
+
+        double sumR = 0.0;
+        double sum = residualSums(p[0], sumR);
+
+        if (grad) {
+            grad[0] = -2.0 * sumR;
+            for (size_t n = 0; n < nPulses; ++n) {
+                const double* values = &templateValues[n * nSamples];
+                const double* derivatives = &templateDerivatives[n * nSamples];
+                double sumRS = 0.0, sumRdS = 0.0;
+                for (size_t i = windowBegin[n]; i < windowEnd[n]; ++i) {
+                    double diff = ys[i] - fittedTrace[i];
+                    sumRS += diff * values[i];
+                    sumRdS += diff * derivatives[i];
+                }
+                grad[1 + n * 2] = -2.0 * sumRS;
+                grad[2 + n * 2] = 2.0 * p[1 + n * 2] * sumRdS;
+            }
         }
         return sum;
     }
 
     std::pair<double, std::vector<double>> minimize(const std::vector<double>& guess, bool use_full_chi2=true) {
+        ++nMinimizations;
+        use_full_chi2 = use_full_chi2 && full_chi2_final_fit;
+        if (use_variable_projection) return minimizeProjected(guess, use_full_chi2);
         
         auto minimization_start = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double, std::micro> elapsed;
@@ -239,26 +323,16 @@ public:
         minimization_start = std::chrono::high_resolution_clock::now();
 
 
-        ROOT::Math::Functor chi2Functor([this](const double* params) {
-            std::vector<double> p(params, params + minimizer->NDim());
-            return this->chi2(p);
-        }, guess.size());
-
-        ROOT::Math::Functor abbreviatedChi2Functor([this](const double* params) {
-            std::vector<double> p(params, params + minimizer->NDim());
-            return this->abbreviated_chi2(p);
-        }, guess.size());
-
+        Chi2Function chi2Function(this, guess.size(), use_full_chi2);
         if (use_full_chi2)
         {
             if (debug) std::cout << "Using full chi2 functions" << std::endl;
-            minimizer->SetFunction(chi2Functor);
-
         }
+        else
         {
             if (debug) std::cout << "Using abbreviated chi2 function evaluated only between " << restricted_chi2_min << " and " << restricted_chi2_max << std::endl;
-            minimizer->SetFunction(abbreviatedChi2Functor);
         }
+        minimizer->SetFunction(chi2Function);
         
         elapsed = std::chrono::high_resolution_clock::now() - minimization_start;
         if (debug) std::cout << "Functor creation took: " << elapsed.count() << " microseconds." << std::endl;
@@ -325,6 +399,72 @@ public:
         return {minimizer->MinValue(), values};
     }
 
+    // Same contract as minimize(), but only the pulse times are handed to Migrad
+    std::pair<double, std::vector<double>> minimizeProjected(const std::vector<double>& guess, bool use_full_chi2=true) {
+        const size_t nPulses = (guess.size() - 1) / 2;
+        std::vector<double> times(nPulses);
+        for (size_t n = 0; n < nPulses; ++n) times[n] = guess[2 + 2 * n];
+
+        if (nPulses > 0) {
+            minimizer->Clear();
+            ProjectedChi2Function projectedFunction(this, nPulses, use_full_chi2);
+            minimizer->SetFunction(projectedFunction);
+            for (size_t n = 0; n < nPulses; ++n) {
+                minimizer->SetVariable(n, "t" + std::to_string(2 + 2 * n), times[n], 1);
+                minimizer->SetVariableLimits(n, times[n] - timeBounds/2., times[n] + timeBounds/2. );
+            }
+            minimizer->Minimize();
+            const double* results = minimizer->X();
+            times.assign(results, results + nPulses);
+        }
+
+        // Re-solve at the final times to get the matching pedestal and amplitudes
+        double chi2Value = projectedChi2(times.data(), nPulses, use_full_chi2);
+        std::vector<double> values(guess.size());
+        values[0] = linearParams[0];
+        for (size_t n = 0; n < nPulses; ++n) {
+            values[1 + 2 * n] = linearParams[1 + n];
+            values[2 + 2 * n] = times[n];
+        }
+
+        if (debug) {
+            std::cout << "Projected minimization result: chi2 = " << chi2Value << ", params: ";
+            for (const auto& val : values) std::cout << val << " ";
+            std::cout << "\n";
+        }
+        return {chi2Value, values};
+    }
+
+    // chi2 as a function of the pulse times only, with the pedestal and amplitudes at their
+    // (bounded) least-squares values. Since those are optimal, the time gradient is simply
+    // dchi2/dt_n = 2 A_n sum r_i S'_n(x_i - t_n). Leaves the linear parameters in linearParams.
+    double projectedChi2(const double* times, size_t nPulses, bool fullModelEvaluation, double* grad = nullptr) {
+        const size_t nSamples = xs.size();
+        prepareTemplateScratch(nPulses, grad != nullptr);
+        for (size_t n = 0; n < nPulses; ++n) {
+            evaluatePulse(n, times[n], fullModelEvaluation, grad != nullptr);
+        }
+
+        if (!solveLinearParameters(nPulses)) {
+            if (grad) std::fill(grad, grad + nPulses, 0.0);
+            return std::numeric_limits<double>::max();
+        }
+        fillFittedTrace(linearParams[0], nPulses, fullModelEvaluation, [&](size_t n) { return linearParams[1 + n]; });
+
+        double sumR = 0.0;
+        double sum = residualSums(linearParams[0], sumR);
+
+        if (grad) {
+            for (size_t n = 0; n < nPulses; ++n) {
+                const double* derivatives = &templateDerivatives[n * nSamples];
+                double sumRdS = 0.0;
+                for (size_t i = windowBegin[n]; i < windowEnd[n]; ++i) sumRdS += (ys[i] - fittedTrace[i]) * derivatives[i];
+                grad[n] = 2.0 * linearParams[1 + n] * sumRdS;
+            }
+        }
+        return sum;
+    }
+
     double performMinimization() {
         double bestChi2 = std::numeric_limits<double>::max();
         double better_chi2 = std::numeric_limits<double>::max();
@@ -333,6 +473,14 @@ public:
 
         // double timeout_limit = 100000; // us
         timeout = false;
+        nMinimizations = 0;
+        converged = false;
+
+        // Nothing to fit in an empty fit range: report a failed (not converged) fit
+        if (xs.empty()) {
+            if (debug) std::cout << "Empty fit range; not fitting." << std::endl;
+            return bestChi2;
+        }
         auto minimization_start = std::chrono::high_resolution_clock::now();
         bool prematureExit = false;
 
@@ -526,6 +674,12 @@ public:
         return bestChi2;
     }
 
+    // Number of minimizer runs in the last performMinimization
+    int GetNMinimizations() const { return nMinimizations; }
+
+    // The starting parameters of the next performMinimization: the pedestal, then amplitude and time per pulse
+    const std::vector<double>& GetGuesses() const { return guesses; }
+
     void reset() {
         // Reset to initial state while retaining the splines
         xs.clear();
@@ -543,6 +697,385 @@ public:
     }
 
 private:
+    // chi2 with analytic gradient as seen by Minuit2; evaluates straight from the parameter array
+    class Chi2Function : public ROOT::Math::IGradientFunctionMultiDim {
+    public:
+        Chi2Function(TemplateFit* fit, unsigned int nDim, bool fullModelEvaluation)
+            : fit_(fit), nDim_(nDim), full_(fullModelEvaluation) {}
+
+        ROOT::Math::IGradientFunctionMultiDim* Clone() const override { return new Chi2Function(*this); }
+        unsigned int NDim() const override { return nDim_; }
+
+        void Gradient(const double* x, double* grad) const override {
+            fit_->evaluateChi2(x, nDim_, full_, grad);
+        }
+
+        void FdF(const double* x, double& f, double* grad) const override {
+            f = fit_->evaluateChi2(x, nDim_, full_, grad);
+        }
+
+    private:
+        double DoEval(const double* x) const override {
+            return fit_->evaluateChi2(x, nDim_, full_);
+        }
+
+        double DoDerivative(const double* x, unsigned int icoord) const override {
+            fit_->gradientScratch.resize(nDim_);
+            fit_->evaluateChi2(x, nDim_, full_, fit_->gradientScratch.data());
+            return fit_->gradientScratch[icoord];
+        }
+
+        TemplateFit* fit_;
+        unsigned int nDim_;
+        bool full_;
+    };
+
+    // chi2 over the pulse times only (variable projection), with its gradient
+    class ProjectedChi2Function : public ROOT::Math::IGradientFunctionMultiDim {
+    public:
+        ProjectedChi2Function(TemplateFit* fit, unsigned int nDim, bool fullModelEvaluation)
+            : fit_(fit), nDim_(nDim), full_(fullModelEvaluation) {}
+
+        ROOT::Math::IGradientFunctionMultiDim* Clone() const override { return new ProjectedChi2Function(*this); }
+        unsigned int NDim() const override { return nDim_; }
+
+        void Gradient(const double* x, double* grad) const override {
+            fit_->projectedChi2(x, nDim_, full_, grad);
+        }
+
+        void FdF(const double* x, double& f, double* grad) const override {
+            f = fit_->projectedChi2(x, nDim_, full_, grad);
+        }
+
+    private:
+        double DoEval(const double* x) const override {
+            return fit_->projectedChi2(x, nDim_, full_);
+        }
+
+        double DoDerivative(const double* x, unsigned int icoord) const override {
+            fit_->gradientScratch.resize(nDim_);
+            fit_->projectedChi2(x, nDim_, full_, fit_->gradientScratch.data());
+            return fit_->gradientScratch[icoord];
+        }
+
+        TemplateFit* fit_;
+        unsigned int nDim_;
+        bool full_;
+    };
+
+    // Least-squares pedestal and amplitudes for the template columns in templateValues, within the same
+    // limits Migrad would use, by the bounded-variable least squares (BVLS) active-set method: starting
+    // from the limits, move towards the unconstrained solution over the free parameters and fix those
+    // that reach a limit; then free the fixed parameter whose limit costs the most chi2, until none does.
+    // Returns false (leaving the parameters at their lower limits) if the fit range has no samples.
+    bool solveLinearParameters(size_t nPulses) {
+        const size_t nSamples = xs.size();
+        const size_t nLin = nPulses + 1;
+        auto lower = [&](size_t k) { return k == 0 ? -2000.0 : minimumAmplitude; };
+        auto upper = [&](size_t k) { return k == 0 ? 2000.0 : maximumAmplitude; };
+
+        linearParams.resize(nLin);
+        for (size_t k = 0; k < nLin; ++k) linearParams[k] = lower(k);
+        if (nSamples == 0) return false;
+
+        // Gram matrix and projections of the data, computed once. Column 0 is the pedestal (all ones),
+        // column 1 + n is template n, which is zero outside its sample window.
+        gram.assign(nLin * nLin, 0.0);
+        ctY.assign(nLin, 0.0);
+        gram[0] = static_cast<double>(nSamples);
+        ctY[0] = traceSumY;
+        for (size_t j = 1; j < nLin; ++j) {
+            const double* sj = &templateValues[(j - 1) * nSamples];
+            for (size_t i = windowBegin[j - 1]; i < windowEnd[j - 1]; ++i) {
+                gram[j] += sj[i];
+                ctY[j] += sj[i] * ys[i];
+            }
+            for (size_t k = j; k < nLin; ++k) {
+                const double* sk = &templateValues[(k - 1) * nSamples];
+                size_t begin = std::max(windowBegin[j - 1], windowBegin[k - 1]);
+                size_t end = std::min(windowEnd[j - 1], windowEnd[k - 1]);
+                double sum = 0.0;
+                for (size_t i = begin; i < end; ++i) sum += sj[i] * sk[i];
+                gram[j * nLin + k] = sum;
+            }
+        }
+        for (size_t j = 0; j < nLin; ++j)
+            for (size_t k = 0; k < j; ++k) gram[j * nLin + k] = gram[k * nLin + j];
+
+        // A template with no samples in range carries no information: it stays at its lower limit
+        linearBlocked.assign(nLin, 0);
+        for (size_t k = 1; k < nLin; ++k) {
+            if (gram[k * nLin + k] <= 0.0) linearBlocked[k] = 1;
+        }
+
+        // Fraction of the step from the current value of k to z at which k reaches a limit (2 if it does not)
+        auto stepToLimit = [&](size_t k, double z) {
+            if (z < lower(k)) return (lower(k) - linearParams[k]) / (z - linearParams[k]);
+            if (z > upper(k)) return (upper(k) - linearParams[k]) / (z - linearParams[k]);
+            return 2.0;
+        };
+
+        // Move towards the least-squares solution over the free parameters, fixing each one that reaches
+        // a limit on the way, until the solution is within the limits. False if the free set is singular.
+        auto descend = [&]() {
+            while (true) {
+                if (!solveFreeParameters(nLin)) return false;
+                const size_t nFree = freeIndices.size();
+                double alpha = 1.0;
+                for (size_t a = 0; a < nFree; ++a) alpha = std::min(alpha, stepToLimit(freeIndices[a], normalRhs[a]));
+                bool fixedAny = false;
+                for (size_t a = 0; a < nFree; ++a) {
+                    size_t k = freeIndices[a];
+                    double z = normalRhs[a];
+                    if (stepToLimit(k, z) <= alpha) {
+                        linearParams[k] = z < lower(k) ? lower(k) : upper(k);
+                        linearFixed[k] = 1;
+                        fixedAny = true;
+                    } else {
+                        linearParams[k] += alpha * (z - linearParams[k]);
+                    }
+                }
+                if (!fixedAny) return true;
+            }
+        };
+
+        // Usually the unconstrained solution is within the limits, and this is the only solve
+        linearFixed = linearBlocked;
+        if (!descend()) {
+            // Degenerate pulses (e.g. two at the same time): free the parameters one at a time below
+            for (size_t k = 0; k < nLin; ++k) {
+                linearParams[k] = lower(k);
+                linearFixed[k] = 1;
+            }
+        }
+
+        for (size_t iteration = 0; iteration < 3 * nLin; ++iteration) {
+            // chi2 decreases if a parameter at its lower (upper) limit moves up (down) when w_k > 0 (< 0)
+            size_t worst = nLin;
+            double worstViolation = 0.0;
+            for (size_t k = 0; k < nLin; ++k) {
+                if (!linearFixed[k] || linearBlocked[k]) continue;
+                double w = ctY[k];
+                for (size_t j = 0; j < nLin; ++j) w -= gram[k * nLin + j] * linearParams[j];
+                double violation = linearParams[k] >= upper(k) ? -w : w;
+                if (violation > worstViolation) {
+                    worstViolation = violation;
+                    worst = k;
+                }
+            }
+            if (worst == nLin) break;
+
+            linearFixed[worst] = 0;
+            if (!descend()) {
+                // Freeing it makes the free set singular: it stays at its limit
+                linearFixed[worst] = 1;
+                linearBlocked[worst] = 1;
+            }
+        }
+        return true;
+    }
+
+    // Least-squares solution over the parameters that are not fixed, with the fixed ones at their
+    // values; the solution is left in normalRhs, in the order of freeIndices
+    bool solveFreeParameters(size_t nLin) {
+        freeIndices.clear();
+        for (size_t k = 0; k < nLin; ++k) if (!linearFixed[k]) freeIndices.push_back(k);
+        const size_t nFree = freeIndices.size();
+
+        normalMatrix.resize(nFree * nFree);
+        normalRhs.resize(nFree);
+        for (size_t a = 0; a < nFree; ++a) {
+            size_t ka = freeIndices[a];
+            double rhs = ctY[ka];
+            for (size_t k = 0; k < nLin; ++k) if (linearFixed[k]) rhs -= gram[ka * nLin + k] * linearParams[k];
+            normalRhs[a] = rhs;
+            for (size_t b = 0; b < nFree; ++b) normalMatrix[a * nFree + b] = gram[ka * nLin + freeIndices[b]];
+        }
+        return solveNormalEquations(nFree);
+    }
+
+    // Gaussian elimination with partial pivoting on normalMatrix; the solution replaces normalRhs
+    bool solveNormalEquations(size_t n) {
+        double* m = normalMatrix.data();
+        double* rhs = normalRhs.data();
+        double scale = 0.0;
+        for (size_t a = 0; a < n; ++a) scale = std::max(scale, std::abs(m[a * n + a]));
+        for (size_t col = 0; col < n; ++col) {
+            size_t pivot = col;
+            for (size_t r = col + 1; r < n; ++r)
+                if (std::abs(m[r * n + col]) > std::abs(m[pivot * n + col])) pivot = r;
+            if (std::abs(m[pivot * n + col]) <= 1e-12 * scale) return false;
+            if (pivot != col) {
+                for (size_t c = 0; c < n; ++c) std::swap(m[col * n + c], m[pivot * n + c]);
+                std::swap(rhs[col], rhs[pivot]);
+            }
+            for (size_t r = col + 1; r < n; ++r) {
+                double factor = m[r * n + col] / m[col * n + col];
+                for (size_t c = col; c < n; ++c) m[r * n + c] -= factor * m[col * n + c];
+                rhs[r] -= factor * rhs[col];
+            }
+        }
+        for (size_t col = n; col-- > 0;) {
+            double value = rhs[col];
+            for (size_t c = col + 1; c < n; ++c) value -= m[col * n + c] * rhs[c];
+            rhs[col] = value / m[col * n + col];
+        }
+        return true;
+    }
+
+    void prepareTemplateScratch(size_t nPulses, bool withDerivatives) {
+        const size_t nSamples = xs.size();
+        templateValues.resize(nPulses * nSamples);
+        if (withDerivatives) templateDerivatives.resize(nPulses * nSamples);
+        windowBegin.resize(nPulses);
+        windowEnd.resize(nPulses);
+    }
+
+    // Template n at time t over the samples it can reach: all of them, or in the abbreviated chi2
+    // only those with x - t in [restricted_chi2_min, restricted_chi2_max] (xs is sorted, so this is
+    // one contiguous index range). Fills templateValues (and templateDerivatives) over that range.
+    void evaluatePulse(size_t n, double t, bool fullModelEvaluation, bool withDerivatives) {
+        const size_t nSamples = xs.size();
+        int whichTemplate = whichSplines[n];
+        if (whichTemplate < 0 || whichTemplate > 1) {
+            std::cerr << "Error: whichTemplate out of bounds: " << whichTemplate << std::endl;
+            throw std::runtime_error("Invalid template selection");
+        }
+
+        size_t begin = 0, end = nSamples;
+        if (!fullModelEvaluation) {
+            begin = std::lower_bound(xs.begin(), xs.end(), t + restricted_chi2_min) - xs.begin();
+            end = std::upper_bound(xs.begin() + begin, xs.end(), t + restricted_chi2_max) - xs.begin();
+        }
+        windowBegin[n] = begin;
+        windowEnd[n] = end;
+
+        double* values = &templateValues[n * nSamples];
+        double* derivatives = withDerivatives ? &templateDerivatives[n * nSamples] : nullptr;
+        if (use_template_table && tables[whichTemplate]) {
+            tables[whichTemplate]->Evaluate(xs.data() + begin, end - begin, t, values + begin,
+                                            derivatives ? derivatives + begin : nullptr);
+        } else {
+            const fitter::CubicSpline& spline = *splines[whichTemplate];
+            const reco::SplineSegments* spline_segments = segments[whichTemplate];
+            for (size_t i = begin; i < end; ++i) {
+                double xi = xs[i] - t;
+                values[i] = spline(xi);
+                if (derivatives) {
+                    derivatives[i] = spline_segments ? spline_segments->Derivative(xi) : splineDerivative(spline, xi);
+                }
+            }
+        }
+    }
+
+    // Union of the pulse windows, as sorted disjoint [begin, end) index ranges, in modelRanges.
+    // Outside these ranges the model is just the pedestal.
+    void mergeWindows(size_t nPulses, bool fullModelEvaluation) {
+        modelRanges.clear();
+        if (fullModelEvaluation) {
+            modelRanges.emplace_back(0, xs.size());
+            return;
+        }
+        for (size_t n = 0; n < nPulses; ++n) {
+            if (windowEnd[n] > windowBegin[n]) modelRanges.emplace_back(windowBegin[n], windowEnd[n]);
+        }
+        std::sort(modelRanges.begin(), modelRanges.end());
+        size_t nMerged = 0;
+        for (size_t r = 0; r < modelRanges.size(); ++r) {
+            if (nMerged > 0 && modelRanges[r].first <= modelRanges[nMerged - 1].second) {
+                modelRanges[nMerged - 1].second = std::max(modelRanges[nMerged - 1].second, modelRanges[r].second);
+            } else {
+                modelRanges[nMerged++] = modelRanges[r];
+            }
+        }
+        modelRanges.resize(nMerged);
+    }
+
+    // Pedestal plus pulses inside modelRanges; fittedTrace is left untouched elsewhere
+    template <typename AmplitudeOf>
+    void fillFittedTrace(double pedestal, size_t nPulses, bool fullModelEvaluation, AmplitudeOf amplitude) {
+        const size_t nSamples = xs.size();
+        mergeWindows(nPulses, fullModelEvaluation);
+        for (const auto& range : modelRanges) {
+            std::fill(fittedTrace.begin() + range.first, fittedTrace.begin() + range.second, pedestal);
+        }
+        for (size_t n = 0; n < nPulses; ++n) {
+            const double amp = amplitude(n);
+            const double* values = &templateValues[n * nSamples];
+            for (size_t i = windowBegin[n]; i < windowEnd[n]; ++i) fittedTrace[i] += amp * values[i];
+        }
+    }
+
+    // chi2 = sum (y - f)^2 and sumR = sum (y - f) over the whole trace. Inside modelRanges they are summed
+    // sample by sample; in the gaps the model is the pedestal and the cached prefix sums give them directly.
+    double residualSums(double pedestal, double& sumR) const {
+        const double shift = pedestal - traceMeanY; // prefix sums are of y - traceMeanY, to avoid cancellation
+        double sum = 0.0;
+        sumR = 0.0;
+        size_t previous = 0;
+        auto addGap = [&](size_t begin, size_t end) {
+            if (end <= begin) return;
+            double n = static_cast<double>(end - begin);
+            double sy = prefixY[end] - prefixY[begin];
+            double syy = prefixYY[end] - prefixYY[begin];
+            sum += syy - 2.0 * shift * sy + n * shift * shift;
+            sumR += sy - n * shift;
+        };
+        for (const auto& range : modelRanges) {
+            addGap(previous, range.first);
+            for (size_t i = range.first; i < range.second; ++i) {
+                double diff = ys[i] - fittedTrace[i];
+                sum += diff * diff; // assumes uniform bin errors
+                sumR += diff;
+            }
+            previous = range.second;
+        }
+        addGap(previous, xs.size());
+        return sum;
+    }
+
+    void cacheTraceSums() {
+        const size_t nSamples = ys.size();
+        traceSumY = 0.0;
+        for (double y : ys) traceSumY += y;
+        traceMeanY = nSamples ? traceSumY / nSamples : 0.0;
+        prefixY.assign(nSamples + 1, 0.0);
+        prefixYY.assign(nSamples + 1, 0.0);
+        for (size_t i = 0; i < nSamples; ++i) {
+            double yc = ys[i] - traceMeanY;
+            prefixY[i + 1] = prefixY[i] + yc;
+            prefixYY[i + 1] = prefixYY[i] + yc * yc;
+        }
+    }
+
+    double templateValue(int whichTemplate, double x) const {
+        if (use_template_table && tables[whichTemplate]) return tables[whichTemplate]->Value(x);
+        return (*splines[whichTemplate])(x);
+    }
+
+    // Slope of a spline without SplineSegments (a TemplateFit not set up by the TemplateFitterService):
+    // fitter::CubicSpline only exposes its value, so take a central difference on the same spline.
+    static double splineDerivative(const fitter::CubicSpline& spline, double x) {
+        constexpr double h = 1e-3;
+        return (spline(x + h) - spline(x - h)) / (2 * h);
+    }
+
+    void createMinimizer() {
+        minimizer = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
+        // minimizer = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Minimize");
+        if (!minimizer)
+        {
+            throw std::runtime_error("Error: Minimzer not created!");
+        }
+        if (debug) std::cout << "   -> minimizer: " << minimizer << std::endl;
+
+        minimizer->SetStrategy(0);
+        minimizer->SetMaxFunctionCalls(1000);
+        minimizer->SetTolerance(1e-6);
+        // minimizer->SetTolerance(1e-3);
+        minimizer->SetPrintLevel(0);
+    }
+
     double findMaxResidual() {
         std::vector<double> residuals = getResidual();
         return *std::max_element(residuals.begin(), residuals.end());
@@ -565,8 +1098,10 @@ private:
         return residuals;
     }
 
-    TSpline3* tsplines[2];
+    TSpline3* tsplines[2] = {nullptr, nullptr};
     fitter::CubicSpline* splines[2];
+    const reco::TemplateTable* tables[2] = {nullptr, nullptr};
+    const reco::SplineSegments* segments[2] = {nullptr, nullptr};
     std::vector<double> xs, ys, yerrs;
     std::vector<int> whichSplines;
     std::vector<double> guesses = {0.0};
@@ -579,9 +1114,17 @@ private:
     size_t maxPulses;
     double chi2Threshold;
     bool debug;
-    ROOT::Math::Minimizer*  minimizer;
+    ROOT::Math::Minimizer*  minimizer = nullptr;
     std::vector<double> fittedTrace;
+    std::vector<double> templateValues, templateDerivatives; // per pulse and sample, valid inside the pulse's window
+    std::vector<size_t> windowBegin, windowEnd;                // sample range each pulse was evaluated on
+    std::vector<std::pair<size_t, size_t>> modelRanges;        // union of the pulse windows
+    std::vector<double> prefixY, prefixYY;                     // prefix sums of y - traceMeanY and its square
+    double traceSumY = 0.0;
+    double traceMeanY = 0.0;
+    std::vector<double> gradientScratch;
     bool timeout;
+    int nMinimizations = 0;
     bool single_spline_only;
 
     double restricted_chi2_min;
@@ -593,5 +1136,14 @@ private:
 
     bool is_seeded;
     bool seeded_extra_leeway;
+    bool use_variable_projection = false;
+    bool use_template_table = false;
+    bool full_chi2_final_fit = false;
+
+    // variable projection scratch space
+    std::vector<double> linearParams, gram, ctY, normalMatrix, normalRhs;
+    std::vector<size_t> freeIndices;
+    std::vector<char> linearFixed;
+    std::vector<char> linearBlocked; // never freed: no samples in range, or degenerate with the free ones
 
 };
@@ -10,6 +10,7 @@
 #include "reco/common/ConfigHolder.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/EventStore.hh"
+#include "reco/common/ThreadPool.hh"
 
 namespace reco {
     
@@ -20,8 +21,33 @@ namespace reco {
         void Configure(std::shared_ptr<const ConfigHolder> configHolder, const ServiceManager& serviceManager, EventStore& eventStore);
         void Run(EventStore& eventStore, const ServiceManager& serviceManager);
 
+        // Let every stage summarize the job, once (ParallelEventProcessor::Finish and
+        // OutputManager::WriteHistograms call this)
+        void EndOfJob(EventStore& eventStore);
+
+        // Number of events reconstructed concurrently (see ParallelEventProcessor)
+        int GetNThreads() const { return nThreads_; }
+        int GetEventQueueDepth() const { return eventQueueDepth_; }
+
+        // Number of threads the stages of one event are spread over (see RunGraph)
+        int GetStageThreads() const { return stageThreads_; }
+
     private:
+        // Order the stages by the collections they consume and produce
+        void BuildStageGraph();
+
+        // Run the stages of one event on the stage pool, each as soon as the stages it depends on are done
+        void RunGraph(EventStore& eventStore, const ServiceManager& serviceManager);
+
         std::vector<std::shared_ptr<RecoStage>> stages_;
+        int nThreads_ = 1;
+        int eventQueueDepth_ = 0;
+
+        int stageThreads_ = 1;
+        std::unique_ptr<ThreadPool> stagePool_;
+        std::vector<std::vector<size_t>> dependents_; // stages that wait for each stage
+        std::vector<int> nDependencies_; // number of stages each stage waits for
+        bool endOfJobDone_ = false;
     };
 } //namespace reco
 
@@ -5,7 +5,10 @@
 #include <nlohmann/json.hpp>
 #include <TObject.h>
 #include <string>
+#include <vector>
 
+#include "reco/common/CollectionHandle.hh"
+#include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/TimeProfilerService.hh"
 
@@ -13,7 +16,6 @@ using json = nlohmann::json;
 
 namespace reco {
 
-    class EventStore;
     // class ServiceManager;
     class ConfigHolder;
 
@@ -26,6 +28,9 @@ namespace reco {
         virtual void Process(EventStore& eventStore, const ServiceManager& serviceManager) const = 0;
         void RunStage(EventStore& eventStore, const ServiceManager& serviceManager);
 
+        // Called once after the last event, with the main EventStore (histograms of all threads merged)
+        virtual void EndOfJob(EventStore& eventStore) {}
+
         void SetRecoLabel(const std::string& recoLabel) { recoLabel_ = recoLabel; }
         const std::string& GetRecoLabel() const { return recoLabel_; }
 
@@ -33,11 +38,64 @@ namespace reco {
             configHolder_ = configHolder;
         }
 
+        // Look up the TimeProfilerService named in the RecoManager config once, before Configure
+        void SetupProfiling(const ServiceManager& serviceManager);
+
+        // "inplace": the stage modifies its input collection instead of making a copy, and its
+        // output label becomes an alias of the input (see EventStore::alias). Only for stages that support it.
+        virtual bool SupportsInplace() const { return false; }
+        void SetInplace(bool inplace) { inplace_ = inplace; }
+        bool IsInplace() const { return inplace_; }
+
+        // Collections this stage reads and writes, as declared with Consumes/Produces in Configure
+        const std::vector<std::string>& GetConsumedLabels() const { return consumedLabels_; }
+        const std::vector<std::string>& GetProducedLabels() const { return producedLabels_; }
+
+        // Whether the stage has said which collections it uses (possibly none, see DeclareNoCollections).
+        // RecoManager runs a stage that has not as a barrier between the stages before and after it.
+        bool DeclaresCollections() const {
+            return noCollections_ || !consumedLabels_.empty() || !producedLabels_.empty();
+        }
+
     protected:
+        // Handle to a collection the stage reads
+        template <typename T>
+        CollectionHandle<T> Consumes(EventStore& eventStore, const std::string& reco_label, const std::string& data_label) {
+            auto handle = eventStore.getHandle<T>(reco_label, data_label);
+            consumedLabels_.push_back(handle.GetLabel());
+            return handle;
+        }
+
+        // For a stage whose Process does not touch the EventStore's collections at all
+        void DeclareNoCollections() { noCollections_ = true; }
+
+        // Handle to a collection the stage writes, under its own reco label
+        template <typename T>
+        CollectionHandle<T> Produces(EventStore& eventStore, const std::string& data_label) {
+            auto handle = eventStore.getHandle<T>(recoLabel_, data_label);
+            producedLabels_.push_back(handle.GetLabel());
+            return handle;
+        }
+
         std::string recoLabel_;
 
+        bool inplace_ = false;
+
+        std::vector<std::string> consumedLabels_;
+        std::vector<std::string> producedLabels_;
+        bool noCollections_ = false;
+
+        // Timer for a part of Process, shown under the stage's timer (kNoTimer without a profiler).
+        // Register in Configure and time with TimeProfilerService::Scope(profiler_, id).
+        TimeProfilerService::TimerId RegisterSubTimer(const std::string& name) {
+            return profiler_ ? profiler_->RegisterTimer(name, timerId_) : TimeProfilerService::kNoTimer;
+        }
+
         std::shared_ptr<const ConfigHolder> configHolder_;
 
+        TimeProfilerService* profiler_ = nullptr; //!
+        TimeProfilerService::TimerId timerId_ = TimeProfilerService::kNoTimer; //!
+
         ClassDef(RecoStage, 1);
     };
 }
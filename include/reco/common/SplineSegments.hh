@@ -0,0 +1,59 @@
+#ifndef SPLINESEGMENTS_HH
+#define SPLINESEGMENTS_HH
+
+#include <vector>
+
+#include "data_products/wfd5/CubicSpline.hh"
+
+namespace reco {
+
+    // The polynomial coefficients of a fitter::CubicSpline, which itself only exposes its value.
+    // Between two knots the spline is one cubic, so four samples of it within the segment give
+    // that cubic exactly (up to rounding); the slope is then b + 2c dx + 3d dx^2.
+    // Beyond the first and last knot the spline is sampled the same way just outside the range,
+    // which reproduces its extrapolation as long as that is a polynomial of at most third degree.
+    class SplineSegments {
+    public:
+        // a + b dx + c dx^2 + d dx^3 with dx = x - x0
+        struct Cubic {
+            double x0 = 0, a = 0, b = 0, c = 0, d = 0;
+
+            double Value(double x) const {
+                double dx = x - x0;
+                return a + dx * (b + dx * (c + dx * d));
+            }
+            double Derivative(double x) const {
+                double dx = x - x0;
+                return b + dx * (2 * c + dx * 3 * d);
+            }
+        };
+
+        SplineSegments() = default;
+
+        // knots: the x positions of the spline's knots, in ascending order (at least two)
+        SplineSegments(const fitter::CubicSpline& spline, const std::vector<double>& knots);
+
+        double Value(double x) const { return Find(x).Value(x); }
+        double Derivative(double x) const { return Find(x).Derivative(x); }
+
+        // The cubic that describes the spline at x
+        const Cubic& Find(double x) const;
+
+        // The extrapolations below the first and above the last knot
+        const Cubic& GetLeft() const { return left_; }
+        const Cubic& GetRight() const { return right_; }
+
+        double GetXMin() const { return knots_.front(); }
+        double GetXMax() const { return knots_.back(); }
+
+    private:
+        // The cubic through the spline at x0, x0 + step, x0 + 2 step, x0 + 3 step
+        static Cubic Sample(const fitter::CubicSpline& spline, double x0, double step);
+
+        std::vector<double> knots_;
+        std::vector<Cubic> segments_; // segments_[i] covers [knots_[i], knots_[i+1]]
+        Cubic left_, right_;
+    };
+} //namespace reco
+
+#endif // SPLINESEGMENTS_HH
@@ -26,6 +26,8 @@ namespace reco {
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::WFD5Waveform> outputWaveforms_; //!
 
         bool debug_;
         bool failOnError_;
@@ -0,0 +1,47 @@
+#ifndef TEMPLATETABLE_HH
+#define TEMPLATETABLE_HH
+
+#include <cstddef>
+#include <vector>
+
+#include "reco/common/SplineSegments.hh"
+
+namespace reco {
+
+    // A pulse template tabulated on a fine uniform grid for the fit's inner loop.
+    // Each grid interval holds the cubic Hermite polynomial through the spline's values and slopes
+    // at its ends, so a lookup is one index computation and a Horner step, with no knot search.
+    // An interval within one knot segment reproduces the spline's cubic exactly; only the intervals
+    // that contain a knot differ from it. Beyond the knot range the spline's own extrapolation is used.
+    class TemplateTable {
+    public:
+        TemplateTable() = default;
+
+        // Tabulate the spline over its knot range with pointsPerUnit grid points per unit of x
+        TemplateTable(const SplineSegments& spline, double pointsPerUnit);
+
+        double Value(double x) const;
+        double Derivative(double x) const;
+
+        // values[i] = T(xs[i] - t), and derivatives[i] = T'(xs[i] - t) when derivatives is not null.
+        // Vectorized with AVX2 when compiled for it, otherwise written for the compiler to vectorize.
+        void Evaluate(const double* xs, size_t n, double t, double* values, double* derivatives = nullptr) const;
+
+        double GetXMin() const { return xMin_; }
+        double GetXMax() const { return xMax_; }
+        size_t GetNIntervals() const { return c0_.size(); }
+
+    private:
+        void EvaluateOne(double x, double t, double& value, double* derivative) const;
+
+        double xMin_ = 0;
+        double xMax_ = 0;
+        double step_ = 1;
+        double invStep_ = 1;
+        // polynomial coefficients per interval in the local coordinate f in [0, 1]
+        std::vector<double> c0_, c1_, c2_, c3_;
+        SplineSegments::Cubic left_, right_; // below xMin_ and above xMax_
+    };
+} //namespace reco
+
+#endif // TEMPLATETABLE_HH
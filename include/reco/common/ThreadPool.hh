@@ -0,0 +1,65 @@
+#ifndef THREADPOOL_HH
+#define THREADPOOL_HH
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace reco {
+
+    // Small work-stealing pool for fanning a loop out inside one stage.
+    // ParallelFor splits the index range over one queue per thread; each thread works from the
+    // back of its own queue and steals from the front of the others once it runs dry.
+    // The calling thread takes part in the loop, so a pool of N threads starts N-1 workers.
+    class ThreadPool {
+    public:
+        explicit ThreadPool(int nThreads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Run body(i) for every i in [0, n) and wait for all of them.
+        // The first exception thrown by body is rethrown here (the remaining indices are skipped).
+        // If the pool is already busy (another event, or a nested call) the loop runs serially on the caller.
+        void ParallelFor(size_t n, const std::function<void(size_t)>& body);
+
+        int GetNThreads() const { return nThreads_; }
+
+    private:
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<size_t> items;
+        };
+
+        void WorkerLoop(int self);
+        void Drain(int self);
+        bool Pop(int self, size_t& item);
+        void RunItem(size_t item);
+
+        int nThreads_;
+        std::vector<std::unique_ptr<WorkQueue>> queues_; // one per thread, the caller uses queue 0
+        std::vector<std::thread> workers_;
+
+        std::mutex runMutex_; // held for the whole of a ParallelFor
+        const std::function<void(size_t)>* body_ = nullptr;
+        std::atomic<size_t> remaining_{0};
+        std::atomic<bool> failed_{false};
+        std::exception_ptr failure_;
+
+        std::mutex mutex_;
+        std::condition_variable workCv_;
+        std::condition_variable doneCv_;
+        unsigned long generation_ = 0;
+        bool stopping_ = false;
+    };
+} //namespace reco
+
+#endif // THREADPOOL_HH
@@ -1,39 +1,102 @@
 #ifndef TIMEPROFILER_SERVICE_HH
 #define TIMEPROFILER_SERVICE_HH
 
+#include <array>
+#include <atomic>
 #include <type_traits>
 #include <stdexcept>
 #include <iostream>
+#include <cstdint>
 #include <cstdlib>
 #include <chrono>
 #include <iomanip>
+#include <memory>
 #include <unordered_map>
+#include <mutex>
 
 #include "reco/common/Service.hh"
 #include "reco/wfd5/ChannelConfig.hh"
 
 namespace reco {
 
-
+    // Timers identified by small integers, registered up front (the RecoPath stages in Configure,
+    // sub-timers of a stage in the stage's Configure), so timing an event needs no string lookups.
+    // Each timer keeps a log-binned histogram of its durations, from which the end-of-job summary
+    // reports p50/p99/max. Recording a timing is lock-free, so the stages may be timed from several threads.
     class TimeProfilerService : public Service {
     public:
-        TimeProfilerService() = default;
+        using TimerId = int;
+        static constexpr TimerId kNoTimer = -1;
+        static constexpr int kMaxTimers = 256;
+
+        // Times the enclosing block: adds the elapsed time to the timer when it goes out of scope.
+        // A scope with no profiler does nothing, so stages can use it unconditionally.
+        class Scope {
+        public:
+            Scope(TimeProfilerService* profiler, TimerId id)
+                : profiler_(id == kNoTimer ? nullptr : profiler), id_(id) {
+                if (profiler_) start_ = std::chrono::steady_clock::now();
+            }
+            ~Scope() {
+                if (profiler_) profiler_->AddTiming(id_, std::chrono::steady_clock::now() - start_);
+            }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            TimeProfilerService* profiler_;
+            TimerId id_;
+            std::chrono::steady_clock::time_point start_;
+        };
+
+        TimeProfilerService();
         virtual ~TimeProfilerService() = default;
         void EndOfJobPrint() const override;
 
         void Configure(const nlohmann::json& config, EventStore& eventStore) override;
 
-         void StartTimer(const std::string& label);
-         void StopTimer(const std::string& label);
+        // Id of the timer with this label under parent (kNoTimer for a top-level timer), registered if new.
+        // Call while configuring, not from the event loop.
+        TimerId RegisterTimer(const std::string& label, TimerId parent = kNoTimer);
+
+        // Record a duration (safe to call from several threads)
+        void AddTiming(TimerId id, std::chrono::steady_clock::duration elapsed);
+
+        void StartTimer(const std::string& label);
+        void StopTimer(const std::string& label);
+
+        // Record an externally measured duration under a top-level timer
+        void AddTiming(const std::string& label, double seconds);
 
     private:
-        std::unordered_map<std::string, double> totalDurations_;
-        std::unordered_map<std::string, int> nEvents_;
+        // Durations in nanoseconds, binned by powers of two split into kSubBins
+        static constexpr int kSubBins = 8;
+        static constexpr int kBins = 64 * kSubBins;
+
+        struct Timer {
+            std::string label;
+            TimerId parent = kNoTimer;
+            std::atomic<uint64_t> count{0};
+            std::atomic<uint64_t> totalNs{0};
+            std::atomic<uint64_t> maxNs{0};
+            std::array<std::atomic<uint64_t>, kBins> bins{};
+        };
+
+        static int BinOf(uint64_t ns);
+        static double BinUpperEdge(int bin);
+
+        // Smallest duration (in seconds) that at least the fraction q of the timings do not exceed
+        double Quantile(const Timer& timer, double q) const;
+
+        void PrintTimer(TimerId id, int depth, int width) const;
+
+        std::unique_ptr<std::array<Timer, kMaxTimers>> timers_; //!
+        std::atomic<int> nTimers_{0}; //!
 
-        std::unordered_map<std::string, std::chrono::time_point<std::chrono::high_resolution_clock>> startTime_;
-        std::unordered_map<std::string, std::chrono::time_point<std::chrono::high_resolution_clock>> endTime_;
+        std::mutex mutex_; //!
+        std::unordered_map<std::string, std::chrono::steady_clock::time_point> startTime_; //!
 
-        ClassDefOverride(TimeProfilerService, 1);
+        ClassDefOverride(TimeProfilerService, 2);
 
     };
 }
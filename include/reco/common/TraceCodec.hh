@@ -0,0 +1,35 @@
+#ifndef TRACECODEC_HH
+#define TRACECODEC_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace reco {
+
+    // Lossless packing of ADC traces.
+    // A trace is stored as its length and first sample, followed by the differences between
+    // neighbouring samples in blocks of kBlockSize. Each block stores its differences zigzag-encoded
+    // with the fewest bits that fit the largest of them, so the flat baseline around the pedestal
+    // takes a few bits per sample instead of 16. The block loops have a fixed length so the
+    // compiler can vectorize them.
+    class TraceCodec {
+    public:
+        static constexpr size_t kBlockSize = 16;
+
+        // Append the encoded trace to out
+        static void Encode(const short* samples, size_t n, std::vector<uint8_t>& out);
+
+        // Decode one trace from data into samples; returns the number of bytes read
+        static size_t Decode(const uint8_t* data, size_t size, std::vector<short>& samples);
+
+    private:
+        static void PutVarint(uint32_t value, std::vector<uint8_t>& out);
+        static uint32_t GetVarint(const uint8_t* data, size_t size, size_t& pos);
+
+        static uint32_t ZigZag(int32_t value) { return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31); }
+        static int32_t UnZigZag(uint32_t value) { return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1); }
+    };
+} //namespace reco
+
+#endif // TRACECODEC_HH
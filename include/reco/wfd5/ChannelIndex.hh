@@ -0,0 +1,43 @@
+#ifndef CHANNELINDEX_HH
+#define CHANNELINDEX_HH
+
+#include <tuple>
+#include <vector>
+
+#include <data_products/common/DataProduct.hh>
+
+namespace reco {
+
+    // Numbers a set of channels 0..n-1 (in ascending (crate, amc, channel) order).
+    // Find() is a bounds check and one load from a table covering the range of crate, AMC and
+    // channel numbers of the set, so per-channel constants can be kept in flat arrays (see ChannelTable).
+    class ChannelIndex {
+    public:
+        static constexpr int kNone = -1;
+
+        ChannelIndex() = default;
+        explicit ChannelIndex(std::vector<dataProducts::ChannelID> channels);
+
+        // Dense index of a channel, or kNone if it is not in the set
+        int Find(const dataProducts::ChannelID& id) const {
+            unsigned crate = std::get<0>(id) - minCrate_;
+            unsigned amc = std::get<1>(id) - minAmc_;
+            unsigned channel = std::get<2>(id) - minChannel_;
+            if (crate >= nCrates_ || amc >= nAmcs_ || channel >= nChannels_) return kNone;
+            return lookup_[(crate * nAmcs_ + amc) * nChannels_ + channel];
+        }
+
+        size_t size() const { return channels_.size(); }
+        bool empty() const { return channels_.empty(); }
+        const dataProducts::ChannelID& GetID(int index) const { return channels_[index]; }
+        const std::vector<dataProducts::ChannelID>& GetChannels() const { return channels_; }
+
+    private:
+        std::vector<dataProducts::ChannelID> channels_;
+        std::vector<int> lookup_;
+        int minCrate_ = 0, minAmc_ = 0, minChannel_ = 0;
+        unsigned nCrates_ = 0, nAmcs_ = 0, nChannels_ = 0;
+    };
+}
+
+#endif // CHANNELINDEX_HH
@@ -6,8 +6,10 @@
 #include <iostream>
 #include <cstdlib>
 
+#include "reco/common/NameTable.hh"
 #include "reco/common/Service.hh"
 #include "reco/wfd5/ChannelConfig.hh"
+#include "reco/wfd5/ChannelIndex.hh"
 
 namespace reco {
 
@@ -23,8 +25,32 @@ namespace reco {
             return channelConfigMap_;
         }
 
+        // Dense index (0..n-1) of the mapped channels, assigned at configure time
+        const std::shared_ptr<const ChannelIndex>& GetChannelIndex() const {
+            return channelIndex_;
+        }
+
+        // Config of the channel with this dense index
+        const ChannelConfig& GetChannelConfig(int index) const {
+            return channelConfigs_[index];
+        }
+
+        // Detector system and subdetector names as small ids (one table for both), by dense index
+        const NameTable& GetNames() const { return names_; }
+        NameTable::Id GetDetectorSystemId(int index) const { return detectorSystemIds_[index]; }
+        NameTable::Id GetSubdetectorId(int index) const { return subdetectorIds_[index]; }
+
+        // Id of "Other", the detector system and subdetector of channels that are not in the map
+        NameTable::Id GetUnmappedId() const { return unmappedId_; }
+
     private:
         std::map<std::tuple<int,int,int>, ChannelConfig> channelConfigMap_;  // key: (crate, wfd5, channel), value: ChannelConfig
+        std::shared_ptr<const ChannelIndex> channelIndex_; //!
+        std::vector<ChannelConfig> channelConfigs_; //! by dense index
+        NameTable names_; //!
+        std::vector<NameTable::Id> detectorSystemIds_; //! by dense index
+        std::vector<NameTable::Id> subdetectorIds_; //! by dense index
+        NameTable::Id unmappedId_ = NameTable::kNoName; //!
 
         ClassDefOverride(ChannelMapService, 1);
 
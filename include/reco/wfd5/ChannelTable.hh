@@ -0,0 +1,65 @@
+#ifndef CHANNELTABLE_HH
+#define CHANNELTABLE_HH
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "reco/wfd5/ChannelIndex.hh"
+
+namespace reco {
+
+    // Per-channel constants of a stage in a flat array, filled at configure time.
+    // Find() resolves the channel through a ChannelIndex and returns null for channels without a value.
+    template <typename T>
+    class ChannelTable {
+    public:
+        ChannelTable() = default;
+
+        // Over an index of the given channels only
+        explicit ChannelTable(const std::map<dataProducts::ChannelID, T>& values)
+            : ChannelTable(std::make_shared<const ChannelIndex>(Keys(values)), values) {}
+
+        // Over a shared index (e.g. the ChannelMapService's); values for channels outside it are dropped
+        ChannelTable(std::shared_ptr<const ChannelIndex> index, const std::map<dataProducts::ChannelID, T>& values)
+            : index_(std::move(index)), values_(index_->size()), present_(index_->size(), 0) {
+            for (const auto& [id, value] : values) {
+                int i = index_->Find(id);
+                if (i == ChannelIndex::kNone) continue;
+                values_[i] = value;
+                present_[i] = 1;
+                ++size_;
+            }
+        }
+
+        const T* Find(const dataProducts::ChannelID& id) const {
+            return index_ ? At(index_->Find(id)) : nullptr;
+        }
+
+        const T* At(int index) const {
+            return index != ChannelIndex::kNone && present_[index] ? &values_[index] : nullptr;
+        }
+
+        bool Contains(const dataProducts::ChannelID& id) const { return Find(id) != nullptr; }
+
+        // Number of channels with a value
+        size_t size() const { return size_; }
+
+        const std::shared_ptr<const ChannelIndex>& GetIndex() const { return index_; }
+
+    private:
+        static std::vector<dataProducts::ChannelID> Keys(const std::map<dataProducts::ChannelID, T>& values) {
+            std::vector<dataProducts::ChannelID> keys;
+            keys.reserve(values.size());
+            for (const auto& entry : values) keys.push_back(entry.first);
+            return keys;
+        }
+
+        std::shared_ptr<const ChannelIndex> index_;
+        std::vector<T> values_;
+        std::vector<char> present_;
+        size_t size_ = 0;
+    };
+}
+
+#endif // CHANNELTABLE_HH
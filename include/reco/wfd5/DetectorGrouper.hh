@@ -1,6 +1,9 @@
 #ifndef DETECTORGROUPER_HH
 #define DETECTORGROUPER_HH
 
+#include <memory>
+#include <vector>
+
 #include <data_products/wfd5/WFD5Waveform.hh>
 
 #include "reco/common/RecoStage.hh"
@@ -8,6 +11,7 @@
 #include "reco/common/ServiceManager.hh"
 #include "reco/wfd5/ChannelMapService.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/WaveformBatch.hh"
 
 namespace reco {
 
@@ -21,12 +25,28 @@ namespace reco {
         void Process(EventStore& store, const ServiceManager& serviceManager) const override;
 
     private:
+        // Output data label of a detector system
+        std::string OutputLabel(const std::string& detectorSystem) const;
+
+        // Where the waveforms of one channel go
+        struct Route {
+            size_t output; // index into outputWaveforms_
+            WaveformBatch::Placement placement;
+        };
 
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsBaseLabel_;
         std::string channelMapServiceLabel_;
 
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        std::vector<CollectionHandle<dataProducts::WFD5Waveform>> outputWaveforms_; //! one per detector system, then "Other"
+
+        // Routing table, made once in Configure
+        std::shared_ptr<const ChannelIndex> channelIndex_; //! the ChannelMapService's
+        std::vector<Route> routes_; //! by channel index
+        Route otherRoute_; //! channels that are not in the channel map
+
         ClassDefOverride(DetectorGrouper, 1);
     };
 }
@@ -8,7 +8,9 @@
 #include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/WaveformBatch.hh"
 #include "reco/wfd5/ChannelMapService.hh"
+#include "reco/wfd5/ChannelTable.hh"
 
 namespace reco {
 
@@ -21,22 +23,27 @@ namespace reco {
 
         void Process(EventStore& store, const ServiceManager& serviceManager) const override;
 
-        void ApplyTimeAligner(dataProducts::WFD5Waveform* wf, dataProducts::TimeSeed* seed, dataProducts::WFD5Waveform* seed_wf, bool foundSeed) const;
+        bool SupportsInplace() const override { return true; }
+
+        void ApplyTimeAligner(WaveformBatch& waveforms, size_t i, dataProducts::TimeSeed* seed, dataProducts::WFD5Waveform* seed_wf, bool foundSeed) const;
 
     private:
 
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::WFD5Waveform> outputWaveforms_; //!
         std::string channelMapServiceLabel_;
 
 
         std::string inputT0Reco_;
         std::string inputT0Label_;
+        CollectionHandle<dataProducts::TimeSeed> inputT0_; //!
         bool requireT0Seed_;
         bool debug_;
 
-        std::map<dataProducts::ChannelID, double> knownTimeOffsetMap_;
+        ChannelTable<double> knownTimeOffsets_; //! over the ChannelMapService's channel index
 
         ClassDefOverride(DigitizerTimeAligner, 1);
     };
@@ -8,6 +8,8 @@
 #include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/WaveformBatch.hh"
+#include "reco/wfd5/ChannelTable.hh"
 
 namespace reco {
 
@@ -25,10 +27,12 @@ namespace reco {
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::WFD5Waveform> outputWaveforms_; //!
         std::string templateLoaderServiceLabel_;
         double minAmplitude_;
 
-        std::map<dataProducts::ChannelID, int> minAmplMap_;
+        ChannelTable<int> minAmplitudes_; //! per-channel minimum amplitudes (-1: always keep)
 
         bool debug_;
         bool failOnError_;
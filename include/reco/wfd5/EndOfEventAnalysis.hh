@@ -26,6 +26,7 @@ namespace reco {
 
         std::string lysoRecoLabel_;
         std::string lysoWaveformsLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> lysoWaveforms_; //!
 
         ClassDefOverride(EndOfEventAnalysis, 1);
     };
@@ -3,12 +3,15 @@
 
 #include <data_products/common/DataProduct.hh>
 #include <data_products/wfd5/WFD5Waveform.hh>
+#include <data_products/wfd5/WaveformIntegral.hh>
+#include <data_products/wfd5/WFD5WaveformFit.hh>
 
 #include "reco/common/RecoStage.hh"
 #include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/wfd5/TemplateLoaderService.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/ChannelTable.hh"
 
 namespace reco {
 
@@ -27,11 +30,14 @@ namespace reco {
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsLabel_;
+        // integrals or fits, depending on the mode
+        CollectionHandle<dataProducts::WaveformIntegral> inputIntegrals_, outputIntegrals_; //!
+        CollectionHandle<dataProducts::WaveformFit> inputFits_, outputFits_; //!
         std::string templateLoaderServiceLabel_;
         double correctionFactor_;
         bool integrals_;
 
-        std::map<dataProducts::ChannelID, double> calibrationMap_;
+        ChannelTable<double> calibrations_; //!
 
         std::string file_name_;
         bool debug_;
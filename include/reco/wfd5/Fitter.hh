@@ -3,14 +3,22 @@
 
 #include <data_products/wfd5/WFD5Waveform.hh>
 #include <data_products/wfd5/TimeSeed.hh>
+#include <data_products/wfd5/WFD5WaveformFit.hh>
+#include <map>
+#include <memory>
 
 #include "reco/common/RecoStage.hh"
 #include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/common/ThreadPool.hh"
+#include "reco/wfd5/SlowFitRecorder.hh"
+#include "reco/wfd5/ChannelIndex.hh"
 
 namespace reco {
 
+    class TemplateFitterService;
+
     class Fitter : public RecoStage {
     public:
         Fitter() {}
@@ -20,7 +28,19 @@ namespace reco {
 
         void Process(EventStore& store, const ServiceManager& serviceManager) const override;
 
+        // Print the fit-cost table and store the slowest fits in the tree t_<recoLabel>_slowFits
+        void EndOfJob(EventStore& eventStore) override;
+
     private:
+        // Fit one waveform into its (already constructed) result slot; returns the number of minimizer runs
+        int FitWaveform(dataProducts::WFD5Waveform* wf, dataProducts::WaveformFit* result,
+                        const TemplateFitterService& templateFitter, dataProducts::TimeSeed* seed) const;
+
+        // Fill the fit-cost histograms with this event's fits
+        void FillFitCost(EventStore& store, const std::vector<dataProducts::WaveformFit*>& results,
+                         const std::vector<int>& nMinimizations) const;
+
+        std::string HistogramName(const std::string& quantity) const { return "h_" + GetRecoLabel() + "_" + quantity; }
 
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
@@ -33,6 +53,24 @@ namespace reco {
         std::string seededInputReco_;
         std::string seededInputLabel_;
 
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::TimeSeed> seededInput_; //! only when seeded
+        CollectionHandle<dataProducts::WaveformFit> outputFitResults_; //!
+
+        int nThreads_ = 1;
+        std::unique_ptr<ThreadPool> threadPool_; //! fits the channels of one event in parallel when nThreads > 1
+
+        // Per-channel time spent preparing the fit and in the minimization
+        TimeProfilerService::TimerId setupTimer_ = TimeProfilerService::kNoTimer; //!
+        TimeProfilerService::TimerId minimizationTimer_ = TimeProfilerService::kNoTimer; //!
+
+        // Fit-cost histograms by channel, see FillFitCost
+        bool fitCost_ = false;
+        double maxFitTime_ = 10000; // microseconds, upper edge of the fit time axes
+        ChannelIndex histogramChannels_; //! x bin - 1 of each channel
+
+        std::unique_ptr<SlowFitRecorder> slowFits_; //! the slowest fits of the job, when "slowFits" > 0
+
         ClassDefOverride(Fitter, 2);
     };
 }
@@ -9,6 +9,8 @@
 #include "reco/common/ServiceManager.hh"
 #include "reco/wfd5/TemplateLoaderService.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/WaveformBatch.hh"
+#include "reco/wfd5/ChannelTable.hh"
 
 namespace reco {
 
@@ -21,15 +23,17 @@ namespace reco {
 
         void Process(EventStore& store, const ServiceManager& serviceManager) const override;
 
-    private:
-        void ApplyJitterCorrection(dataProducts::WFD5Waveform* wf) const;
+        bool SupportsInplace() const override { return true; }
 
+    private:
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::WFD5Waveform> outputWaveforms_; //!
         std::string templateLoaderServiceLabel_;
         
-        std::map<dataProducts::ChannelID, int> offsetMap_;
+        ChannelTable<int> offsets_; //! odd/even pedestal difference per channel
 
         bool debug_;
         bool failOnError_;
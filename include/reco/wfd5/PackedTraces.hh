@@ -0,0 +1,41 @@
+#ifndef PACKEDTRACES_HH
+#define PACKEDTRACES_HH
+
+#include <cstdint>
+#include <vector>
+
+#include <TClonesArray.h>
+#include <TObject.h>
+
+#include <data_products/wfd5/WFD5Waveform.hh>
+
+namespace reco {
+
+    // The traces of one WFD5Waveform collection packed with TraceCodec, in the order of the collection.
+    // The OutputManager writes it next to a collection it packs, whose waveforms are then written
+    // without their trace. Restore puts the traces back after reading.
+    class PackedTraces : public TObject {
+    public:
+        PackedTraces() = default;
+
+        void Clear(Option_t* option = "") override;
+
+        void Add(const std::vector<short>& trace);
+
+        size_t size() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+        size_t GetPackedBytes() const { return data_.size(); }
+
+        void Decode(size_t i, std::vector<short>& trace) const;
+
+        // Put trace i into waveform i of the collection the traces were packed from
+        void Restore(TClonesArray& waveforms) const;
+
+    private:
+        std::vector<uint8_t> data_;
+        std::vector<uint32_t> offsets_; // start of each trace in data_, plus the end
+
+        ClassDefOverride(PackedTraces, 1)
+    };
+} //namespace reco
+
+#endif // PACKEDTRACES_HH
@@ -10,6 +10,7 @@
 #include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/WaveformBatch.hh"
 
 namespace reco {
 
@@ -22,13 +23,21 @@ namespace reco {
 
         void Process(EventStore& store, const ServiceManager& serviceManager) const override;
 
+        bool SupportsInplace() const override { return true; }
+
         void ComputePedestal(dataProducts::WFD5Waveform* wf) const;
 
+        // Pedestal level and stdev of a trace, from the samples [startIndex, endIndex)
+        void ComputePedestal(const short* trace, size_t length, double& pedestal, double& pedestalStdev,
+                             int& startIndex, int& endIndex) const;
+
     private:
 
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::WFD5Waveform> outputWaveforms_; //!
         std::string pedestalMethod_; // e.g. "FirstN", "MiddleN", "LastN"
         int numSamples_;
         bool debug_;
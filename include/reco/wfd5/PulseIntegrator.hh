@@ -10,6 +10,7 @@
 #include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/ChannelTable.hh"
 
 namespace reco {
 
@@ -42,12 +43,16 @@ namespace reco {
         std::string file_name_;
 
         PulseIntegrationConfig defaultConfig_;
-        std::map<dataProducts::ChannelID, PulseIntegrationConfig> channelConfigMap_;
+        ChannelTable<PulseIntegrationConfig> channelConfigs_; //! overrides of the default config
 
         bool seeded_;
         std::string inputSeedRecoLabel_;
         std::string inputSeedLabel_;
 
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::TimeSeed> inputSeed_; //! only when seeded
+        CollectionHandle<dataProducts::WaveformIntegral> outputIntegrals_; //!
+
         ClassDefOverride(PulseIntegrator, 1);
     };
 }
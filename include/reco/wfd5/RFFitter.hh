@@ -6,6 +6,12 @@
 #include <TF1.h>
 #include <TMath.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include <data_products/wfd5/WFD5Waveform.hh>
 #include <data_products/wfd5/RFWaveformFit.hh>
 
@@ -13,6 +19,8 @@
 #include "reco/common/EventStore.hh"
 #include "reco/common/ServiceManager.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/RFLinearFit.hh"
+#include "reco/wfd5/RFPhaseTrackerService.hh"
 
 namespace reco {
 
@@ -27,17 +35,44 @@ namespace reco {
 
         void PerformRFFit(const dataProducts::WFD5Waveform* waveform, dataProducts::RFWaveformFit* fitResult) const;
 
+        // Fixed frequency: A cos(wx) + B sin(wx) + C is linear in A, B and C, so it is solved directly
+        void PerformLinearRFFit(const dataProducts::WFD5Waveform* waveform, dataProducts::RFWaveformFit* fitResult) const;
+
+        // Linear fit at the frequency the RFPhaseTrackerService follows for this channel
+        void PerformTrackedRFFit(const dataProducts::WFD5Waveform* waveform, dataProducts::RFWaveformFit* fitResult) const;
 
     private:
+        void FillLinearResult(const RFLinearFit::Result& fit, double freq, size_t traceSize, dataProducts::RFWaveformFit* fitResult) const;
+
+        // Starting values from the zero crossings of the trace (frequency only if none is configured)
+        void EstimateParameters(const std::vector<short>& trace, double& freq, double& amplitude, double& phase, double& baseline) const;
+
+        // The samples the fit uses: the fit range with the 'R' option, else the whole trace
+        void FitWindow(size_t traceSize, int& first, int& last) const;
+
+        // The basis for the configured frequency over [first, last], tabulated the first time a trace
+        // has this window. The window only depends on the trace length, so only a few are ever made.
+        const RFLinearFit& GetBasis(int first, int last) const;
 
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputFitResultLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::RFWaveformFit> outputFitResults_; //!
         double fitStartTime_;
         double fitEndTime_;
         double frequency_;
         bool fixFrequency_;
         std::string fitOption_;
+        bool useRange_;
+        bool storeFitFunction_;
+        struct BasisCache {
+            std::mutex mutex;
+            std::map<std::pair<int, int>, RFLinearFit> bases; // by (first, last)
+        };
+        std::unique_ptr<BasisCache> bases_; //! see GetBasis
+        std::string phaseTrackerLabel_;
+        std::shared_ptr<RFPhaseTrackerService> phaseTracker_; //! only with a phaseTrackerLabel
 
         ClassDefOverride(RFFitter, 1);
     };
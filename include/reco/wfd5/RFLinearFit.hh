@@ -0,0 +1,46 @@
+#ifndef RFLINEARFIT_HH
+#define RFLINEARFIT_HH
+
+#include <vector>
+
+namespace reco {
+
+    // Least-squares fit of A cos(wx) + B sin(wx) + C to the samples [first, last] of a trace, at a fixed w.
+    // The model is linear in A, B and C, so once the basis is tabulated a fit is three sums and a 3x3 solve.
+    class RFLinearFit {
+    public:
+        struct Result {
+            double a = 0.0; // cos coefficient
+            double b = 0.0; // sin coefficient
+            double c = 0.0; // pedestal
+            double chi2 = 0.0; // unit errors
+            int ndf = 0;
+            bool valid = false;
+
+            double Amplitude() const;
+            double Phase() const; // atan2(b, a)
+        };
+
+        RFLinearFit() = default;
+
+        // Tabulate cos(wx) and sin(wx) over [first, last] and invert the normal matrix.
+        // The basis is invalid for fewer than 3 samples or a frequency that makes the columns degenerate.
+        void SetBasis(double frequency, int first, int last);
+
+        bool IsValid() const { return valid_; }
+        double GetFrequency() const { return frequency_; }
+
+        // Fit the samples [first, last] of trace (which must hold at least last + 1 samples)
+        Result Fit(const short* trace) const;
+
+    private:
+        double frequency_ = 0.0;
+        int first_ = 0;
+        std::vector<double> cos_;
+        std::vector<double> sin_;
+        double inverse_[3][3] = {};
+        bool valid_ = false;
+    };
+}
+
+#endif // RFLINEARFIT_HH
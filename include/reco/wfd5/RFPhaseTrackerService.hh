@@ -0,0 +1,60 @@
+#ifndef RFPHASETRACKERSERVICE_HH
+#define RFPHASETRACKERSERVICE_HH
+
+#include <map>
+#include <mutex>
+
+#include <data_products/common/DataProduct.hh>
+
+#include "reco/common/Service.hh"
+#include "reco/wfd5/RFLinearFit.hh"
+
+namespace reco {
+
+    // Follows the frequency of each RF channel from event to event.
+    //
+    // Each update fits A cos(wx) + B sin(wx) + C to the fit window at the channel's current frequency w
+    // (a linear fit, see RFLinearFit), which gives the phase of the event. The window is also fit in two
+    // halves: at the true frequency w + d the phase of the second half lags the first by d times their
+    // distance, so w moves by "gain" times that estimate of d (at most "maxStep" rad/sample per event).
+    // All channels start at the configured "frequency" (rad/sample).
+    //
+    // When events are processed on several threads the updates arrive in no fixed order, so the
+    // tracked frequency (and the phases) may differ slightly between runs.
+    class RFPhaseTrackerService : public Service {
+    public:
+        RFPhaseTrackerService() = default;
+        ~RFPhaseTrackerService() override = default;
+
+        void Configure(const nlohmann::json& config, EventStore& eventStore) override;
+
+        // Fit the samples [first, last] of this channel's trace at the tracked frequency (returned in frequency)
+        // and update the frequency. Thread safe.
+        RFLinearFit::Result Update(dataProducts::ChannelID id, const short* trace, int first, int last, double& frequency);
+
+        // Tracked frequency of a channel (the configured one before its first update)
+        double GetFrequency(dataProducts::ChannelID id) const;
+
+        void EndOfJobPrint() const override;
+
+    private:
+        struct ChannelState {
+            double frequency = 0.0;
+            long nUpdates = 0;
+            double lastStep = 0.0; // frequency correction of the last update
+        };
+
+        double frequency_;
+        double gain_;
+        double maxStep_;
+        double minAmplitude_; // halves with a smaller fitted amplitude do not update the frequency
+        bool debug_;
+
+        std::map<dataProducts::ChannelID, ChannelState> channels_; //!
+        mutable std::mutex mutex_; //!
+
+        ClassDefOverride(RFPhaseTrackerService, 1);
+    };
+}
+
+#endif // RFPHASETRACKERSERVICE_HH
@@ -0,0 +1,52 @@
+#ifndef SLOWFITRECORDER_HH
+#define SLOWFITRECORDER_HH
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <data_products/common/DataProduct.hh>
+
+namespace reco {
+
+    // Keeps the K slowest fits of the job with what is needed to replay them (the trace, the seed,
+    // the initial guesses and the fitter settings of the channel).
+    // Safe to use from several threads; IsCandidate lets the caller skip copying the trace of a fit
+    // that is faster than all of the K kept so far.
+    class SlowFitRecorder {
+    public:
+        struct Entry {
+            double fitTime = 0;   // microseconds
+            dataProducts::ChannelID id;
+            int eventNum = 0;
+            int waveformIndex = 0;
+            bool seeded = false;
+            double seedTime = 0;
+            std::vector<double> guesses; // initial pedestal, (amplitude, time) pairs as given to the minimization
+            std::string fitConfig; // the TemplateFit settings of the channel, as json
+            double chi2 = 0;
+            int nPulses = 0;
+            int nMinimizations = 0;
+            bool timeout = false;
+            std::vector<short> trace;
+        };
+
+        explicit SlowFitRecorder(size_t capacity);
+
+        bool IsCandidate(double fitTime) const { return fitTime > threshold_.load(std::memory_order_relaxed); }
+
+        void Add(Entry entry);
+
+        // The kept fits, slowest first
+        std::vector<Entry> GetSlowest() const;
+
+    private:
+        size_t capacity_;
+        std::vector<Entry> heap_; // min-heap on fitTime
+        std::atomic<double> threshold_{-1.}; // fastest kept fit once the heap is full
+        mutable std::mutex mutex_;
+    };
+} //namespace reco
+
+#endif // SLOWFITRECORDER_HH
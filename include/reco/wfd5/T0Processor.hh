@@ -28,6 +28,8 @@ namespace reco {
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputT0TimeRefLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::TimeSeed> outputT0TimeRef_; //!
         std::pair<int,int> triggerSearchWindow_;
         bool failIfT0OutsideWindow_;
         bool failIfT0NotFound_;
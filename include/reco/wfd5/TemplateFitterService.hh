@@ -5,15 +5,43 @@
 #include <stdexcept>
 #include <iostream>
 #include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "reco/common/Service.hh"
 #include "reco/wfd5/TemplateLoaderService.hh"
 #include "reco/common/PulseFitterUtil.hh"
+#include "reco/wfd5/ChannelTable.hh"
 
 namespace reco {
 
     class TemplateFitterService : public Service {
+    private:
+        struct FitterPool;
+
     public:
+        // A fitter borrowed from the pool of one channel. It is returned to the pool when the lease goes out of scope.
+        class FitterLease {
+        public:
+            FitterLease() = default;
+            FitterLease(FitterPool* pool, std::unique_ptr<TemplateFit> fitter);
+            FitterLease(FitterLease&& other) noexcept = default;
+            FitterLease& operator=(FitterLease&& other) noexcept;
+            ~FitterLease();
+
+            TemplateFit* operator->() const { return fitter_.get(); }
+            TemplateFit& operator*() const { return *fitter_; }
+            TemplateFit* get() const { return fitter_.get(); }
+
+        private:
+            void Release();
+
+            FitterPool* pool_ = nullptr;
+            std::unique_ptr<TemplateFit> fitter_;
+        };
+
         TemplateFitterService() = default;
         virtual ~TemplateFitterService() = default;
 
@@ -53,15 +81,27 @@ namespace reco {
                 if (debug_) std::cout << "Creating a template fit for channel:" 
                     << std::get<0>(id) << "/" << std::get<1>(id) << "/" << std::get<2>(id) 
                     << std::endl;
-                pulseFitterHolder_[id] = new TemplateFit(
+                auto& pool = fitterPools_[id];
+                pool = std::make_unique<FitterPool>();
+                pool->prototype = std::make_unique<TemplateFit>(
                     templateLoader->GetSpline(id),
                     templateLoader->GetSpline(id) // potential for a second spline (i.e. particle vs. laser pulse shape)
                 );
                 
-                pulseFitterHolder_[id]->SetTSpline( templateLoader->GetTemplate(id),0 );
-                pulseFitterHolder_[id]->SetTSpline( templateLoader->GetTemplate(id),1 );
+                pool->prototype->SetTSpline( templateLoader->GetTemplate(id),0 );
+                pool->prototype->SetTSpline( templateLoader->GetTemplate(id),1 );
+                pool->prototype->SetTemplateTable( templateLoader->GetTable(id),0 );
+                pool->prototype->SetTemplateTable( templateLoader->GetTable(id),1 );
+                pool->prototype->SetSplineSegments( templateLoader->GetSegments(id),0 );
+                pool->prototype->SetSplineSegments( templateLoader->GetSegments(id),1 );
+
+                // Reference the template once here, so that the TRefs made in setFitResult
+                // never have to assign an object ID from several threads at once
+                TRef templateRef(templateLoader->GetTemplate(id));
+
                 if (debug_) std::cout << "    -> Loading default config " << std::endl;
-                pulseFitterHolder_[id]->SetValueFromConfig(config);
+                pool->prototype->SetValueFromConfig(config);
+                pool->config = config;
                 if (debug_) std::cout << "    -> Done loading default config " << std::endl;
 
                 // configure this template fitter based on the json file
@@ -72,32 +112,60 @@ namespace reco {
             for (const auto& configi : fitterConfig_["fitters"]) {
                 std::vector<int> jid = configi["channel"];
                 dataProducts::ChannelID id = {jid[0],jid[1],jid[2]};
-                if (pulseFitterHolder_.count(id))
+                if (fitterPools_.count(id))
                 {
                     if (debug_) std::cout << "overriding default fitter values for channel: " << jid[0] << "/" <<jid[1] << "/" <<jid[2] << std::endl;
-                    pulseFitterHolder_[id]->SetValueFromConfig(configi);
+                    fitterPools_[id]->prototype->SetValueFromConfig(configi);
+                    fitterPools_[id]->config.update(configi);
                     if (debug_) std::cout << "    -> Done loading override config " << std::endl;
                     
                 }
             }
 
+            // Flat lookup of the pools for GetFitter
+            std::map<dataProducts::ChannelID, FitterPool*> pools;
+            for (const auto& [id, pool] : fitterPools_) pools[id] = pool.get();
+            poolTable_ = ChannelTable<FitterPool*>(pools);
+
 
         }
 
-        bool ValidChannel(dataProducts::ChannelID id)
+        bool ValidChannel(dataProducts::ChannelID id) const
         {
-            return pulseFitterHolder_.count(id);
+            return poolTable_.Contains(id);
         }
 
-        TemplateFit* GetFitter( dataProducts::ChannelID id )
+        // Channels with a fitter, in ascending order
+        std::vector<dataProducts::ChannelID> GetValidChannels() const
+        {
+            std::vector<dataProducts::ChannelID> channels;
+            channels.reserve(fitterPools_.size());
+            for (const auto& [id, pool] : fitterPools_) channels.push_back(id);
+            return channels;
+        }
+
+        // Borrow a fitter for this channel. Each concurrent user gets its own copy of the
+        // configured fitter (own minimizer and scratch vectors, shared templates); copies are
+        // made on first demand and reused afterwards.
+        FitterLease GetFitter( dataProducts::ChannelID id ) const;
+
+        // The settings the fitter of this channel was configured with (the defaults updated by its override)
+        const nlohmann::json& GetFitConfig( dataProducts::ChannelID id ) const
         {
-            return pulseFitterHolder_[id];
+            return fitterPools_.at(id)->config;
         }
 
     private:
+        struct FitterPool {
+            std::unique_ptr<TemplateFit> prototype;         // configured fitter, never used to fit
+            nlohmann::json config;                          // what the prototype was configured with
+            std::vector<std::unique_ptr<TemplateFit>> idle; // copies not leased at the moment
+            std::mutex mutex;
+        };
 
         std::string templateLoaderLabel_;
-        std::map<dataProducts::ChannelID, TemplateFit*> pulseFitterHolder_;
+        std::map<dataProducts::ChannelID, std::unique_ptr<FitterPool>> fitterPools_; //!
+        ChannelTable<FitterPool*> poolTable_; //! the pools above by dense channel index
         nlohmann::json fitterConfig_;
         bool debug_;
 
@@ -5,6 +5,8 @@
 #include <stdexcept>
 #include <iostream>
 #include <cstdlib>
+#include <map>
+#include <memory>
 
 #include "reco/common/Service.hh"
 #include "data_products/common/DataProduct.hh"
@@ -12,6 +14,8 @@
 #include "TFile.h"
 #include "data_products/wfd5/CubicSpline.hh"
 #include "data_products/wfd5/WFD5WaveformFit.hh"
+#include "reco/common/SplineSegments.hh"
+#include "reco/common/TemplateTable.hh"
 
 namespace reco {
 
@@ -32,6 +36,12 @@ namespace reco {
 
         fitter::CubicSpline* GetSpline(dataProducts::ChannelID id);
 
+        // Oversampled lookup table of the channel's template (nullptr if it has none)
+        const TemplateTable* GetTable(dataProducts::ChannelID id) const;
+
+        // Polynomial coefficients of the channel's spline, for its exact slope (nullptr if it has none)
+        const SplineSegments* GetSegments(dataProducts::ChannelID id) const;
+
         fitter::CubicSpline* buildCubicSpline(const TSpline3* tSpline, fitter::CubicSpline::BoundaryType cond);
 
         dataProducts::ChannelList GetValidChannels();
@@ -39,6 +49,8 @@ namespace reco {
         std::shared_ptr<dataProducts::SplineHolder> GetSplineHolder();
 
     private:
+        void BuildTables();
+
         std::string file_path_;
         // std::map<dataProducts::ChannelID, TSpline3*> template_map_;
         std::shared_ptr<dataProducts::SplineHolder> splineHolder_;
@@ -46,6 +58,10 @@ namespace reco {
         nlohmann::json templateConfig_;
         bool debug_;
 
+        double tablePointsPerSample_ = 16;
+        std::map<dataProducts::ChannelID, std::unique_ptr<TemplateTable>> tables_; //!
+        std::map<dataProducts::ChannelID, std::unique_ptr<SplineSegments>> segments_; //!
+
         ClassDefOverride(TemplateLoaderService, 1);
 
     };
@@ -4,6 +4,7 @@
 #include <data_products/common/DataProduct.hh>
 #include <data_products/wfd5/WFD5Waveform.hh>
 #include <data_products/wfd5/TimeSeed.hh>
+#include <data_products/wfd5/WFD5WaveformFit.hh>
 
 #include "reco/common/RecoStage.hh"
 #include "reco/common/EventStore.hh"
@@ -28,6 +29,8 @@ namespace reco {
         double correctionFactor_;
         std::string inputFitResultsLabel_;
         std::string outputSeedLabel_;
+        CollectionHandle<dataProducts::WaveformFit> inputFitResults_; //! only when seeding from a fit
+        CollectionHandle<dataProducts::TimeSeed> outputSeed_; //!
 
         bool seedFromMaxAmplitudeFit_;
         bool seedFromFirstFit_;
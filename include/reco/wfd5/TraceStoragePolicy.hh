@@ -0,0 +1,60 @@
+#ifndef TRACESTORAGEPOLICY_HH
+#define TRACESTORAGEPOLICY_HH
+
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <data_products/wfd5/WFD5Waveform.hh>
+
+#include "reco/common/CollectionMatcher.hh"
+#include "reco/common/EventStore.hh"
+
+namespace reco {
+
+    // Which events keep their full traces in the output (the Output block's "tracePolicy").
+    // Every Nth event, and every event with a fit that has a large chi2, timed out or has several
+    // pulses, is written as is. In the other events the traces of the chosen collections are either
+    // emptied or reduced to windows around the fitted pulses: samples outside the windows are set to
+    // the pedestal, so sample indices are unchanged and the flat runs cost almost nothing compressed.
+    class TraceStoragePolicy {
+    public:
+        enum class Reduction { kNone, kWindow };
+
+        // What the policy decided for one event
+        struct Decision {
+            bool fullTraces = true;
+            std::map<dataProducts::ChannelID, std::vector<double>> pulseTimes; // fitted times (in samples) by channel
+        };
+
+        explicit TraceStoragePolicy(const nlohmann::json& config);
+
+        // Whether the policy applies to the traces of this collection
+        bool Applies(const std::string& collection) const { return collections_.Matches(collection); }
+
+        // event counts the events written so far
+        Decision Decide(const EventStore& eventStore, Long64_t event) const;
+
+        // The trace to write for a waveform whose full trace is in trace
+        void Reduce(const Decision& decision, const dataProducts::WFD5Waveform& waveform,
+                    const std::vector<short>& trace, std::vector<short>& out) const;
+
+    private:
+        CollectionMatcher collections_;
+        std::string fitsLabel_;
+
+        Long64_t prescale_ = 0; // 0: no prescaled events
+        double chi2Threshold_ = std::numeric_limits<double>::infinity();
+        bool keepTimeouts_ = false;
+        int maxPulses_ = std::numeric_limits<int>::max();
+
+        Reduction reduction_ = Reduction::kWindow;
+        int windowBefore_ = 10;
+        int windowAfter_ = 40;
+    };
+} //namespace reco
+
+#endif // TRACESTORAGEPOLICY_HH
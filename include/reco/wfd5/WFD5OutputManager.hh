@@ -3,6 +3,8 @@
 
 #include "reco/common/OutputManager.hh"
 #include "reco/wfd5/TemplateLoaderService.hh"
+#include "reco/wfd5/PackedTraces.hh"
+#include "reco/wfd5/TraceStoragePolicy.hh"
 
 // any new dataproduct to be written to the tree must be included here!
 #include <data_products/wfd5/WFD5Header.hh>
@@ -22,8 +24,28 @@ namespace reco {
 
         void WriteODB(const EventStore& eventStore) override;
 
+    protected:
+        // 'packTraces' and 'tracePolicy' of the 'Output' block
+        void ConfigureOutput(const nlohmann::json& outputConfig) override;
+        void BranchCreated(const std::string& name, TClonesArray* buffer) override;
+
+        // Swap the traces to write into the waveforms before Fill, and the full traces back after
+        void PrepareFill(const EventStore& eventStore) override;
+        void FinishFill() override;
+
     private:
-        
+        // WFD5Waveform collections whose traces are not written as they are: packed with TraceCodec
+        // and/or reduced by the trace storage policy
+        struct TraceCollection {
+            bool reduce = false;
+            std::unique_ptr<PackedTraces> packed; // null if not packed
+            PackedTraces* slot = nullptr; // branch address
+            std::vector<std::vector<short>> stash; // the traces, taken out of the waveforms while the tree is filled
+            bool swapped = false; // whether the traces of this event are in the stash
+        };
+        CollectionMatcher packMatcher_;
+        std::unique_ptr<TraceStoragePolicy> tracePolicy_;
+        std::map<std::string, TraceCollection> traceCollections_;
     };
 }
 
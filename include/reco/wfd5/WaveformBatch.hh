@@ -0,0 +1,135 @@
+#ifndef WAVEFORMBATCH_HH
+#define WAVEFORMBATCH_HH
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <data_products/wfd5/WFD5Waveform.hh>
+
+#include "reco/common/EventBatch.hh"
+#include "reco/common/NameTable.hh"
+#include "reco/common/EventStore.hh"
+
+namespace reco {
+
+    // The WFD5 waveforms of one event in columns, shared between the stages that prepare them.
+    //
+    // Every row refers to a source WFD5Waveform (usually the unpacker's), which supplies whatever a
+    // stage does not change. On top of that the batch holds the traces in one contiguous buffer and
+    // the fields the preparation stages set (run/subrun, digitization frequency, pedestal, time alignment,
+    // detector placement).
+    // Batches made with ShareFrom share these columns and only copy one when they write to it, so
+    // a stage that just sets the pedestal or drops rows does not copy any trace.
+    //
+    // WFD5Waveform objects are only made for collections that are asked for with EventStore::get or
+    // that the OutputManager writes (see EventBatch). They are constructed from the source waveform,
+    // so whatever the WFD5Waveform(const WFD5Waveform*) constructor links to its origin points at the
+    // source (the unpacker's waveform), not at an object of the previous preparation stage, which
+    // is never made unless that collection is materialized as well.
+    class WaveformBatch : public EventBatch {
+    public:
+        using Handle = CollectionHandle<dataProducts::WFD5Waveform>;
+
+        // Where a channel sits in the detector (set by the DetectorGrouper). The names are
+        // interned ids, only turned into strings when a row is made into a WFD5Waveform.
+        struct Placement {
+            const NameTable* names = nullptr;
+            NameTable::Id detectorSystem = NameTable::kNoName;
+            NameTable::Id subdetector = NameTable::kNoName;
+            double x = 0.0;
+            double y = 0.0;
+        };
+
+        WaveformBatch() = default;
+
+        // The waveforms stored under this name: the batch itself, or a view of the TClonesArray stored there
+        static const WaveformBatch& Get(EventStore& store, const Handle& handle);
+
+        // A new (empty) batch under this name
+        static WaveformBatch& Create(EventStore& store, const Handle& handle);
+
+        // The batch a stage writes its copy of the input waveforms to: a new batch sharing the input's
+        // columns, or the input batch itself when the output label is an alias of it (in-place stages)
+        static WaveformBatch& Derive(EventStore& store, const Handle& input, const Handle& output);
+
+        size_t size() const { return rows_.size(); }
+
+        // Same rows as other, sharing its columns
+        void ShareFrom(const WaveformBatch& other);
+
+        // Only the given rows of other (in that order), sharing its columns
+        void ShareRowsFrom(const WaveformBatch& other, const std::vector<size_t>& rows);
+
+        // The waveform row i was made from. Fields changed through this batch are not reflected here.
+        const dataProducts::WFD5Waveform& Source(size_t i) const { return *(*sources_)[rows_[i]]; }
+        dataProducts::ChannelID GetID(size_t i) const { return Source(i).GetID(); }
+
+        const short* Trace(size_t i) const;
+        size_t TraceLength(size_t i) const;
+        bool TracesModified() const { return static_cast<bool>(traces_); }
+
+        // Writable trace of row i (copies the trace column the first time it is shared)
+        short* MutableTrace(size_t i);
+
+        void SetRunSubrun(size_t i, int run, int subrun);
+        void SetDigitizationFrequency(size_t i, double frequency);
+        // Pedestal from the samples [startSample, endSample) of the trace
+        void SetPedestal(size_t i, double level, double stdev, int startSample, int endSample);
+        void SetTimeAlignment(size_t i, int digitizationShift, double timeOffset);
+        // The placement is not copied: it must outlive the batch and its materialized rows (e.g. be owned by a stage)
+        void SetPlacement(size_t i, const Placement* placement);
+
+        // Row i written into scratch, for WFD5Waveform methods that work on the trace (e.g. PeakToPeak).
+        // scratch gets the channel and event numbers, the trace and the fields the batch mirrors; run/subrun
+        // and the digitization frequency only if a stage has set them through the batch.
+        void LoadRow(size_t i, dataProducts::WFD5Waveform& scratch) const;
+
+        // Append row i to out as a new WFD5Waveform
+        dataProducts::WFD5Waveform* MaterializeRow(size_t i, TClonesArray& out) const;
+
+        TClass* GetElementClass() const override;
+        void Materialize(TClonesArray& out) const override;
+        void Clear() override;
+
+    private:
+        // Contiguous samples of all source rows, indexed by source row
+        struct TraceColumn {
+            std::vector<short> samples;
+            std::vector<size_t> offsets; // n + 1 entries
+        };
+
+        enum Field : uint8_t {
+            kRunSubrun = 1 << 0,
+            kFrequency = 1 << 1,
+            kPedestal = 1 << 2,
+            kTimeAlignment = 1 << 3,
+            kPlacement = 1 << 4,
+        };
+
+        // Fields set by the stages, indexed by source row
+        struct MetadataColumns {
+            std::vector<uint8_t> set;
+            std::vector<int> run, subrun;
+            std::vector<double> frequency;
+            std::vector<double> pedestalLevel, pedestalStdev;
+            std::vector<int> pedestalStart, pedestalEnd;
+            std::vector<int> digitizationShift;
+            std::vector<double> timeOffset;
+            std::vector<const Placement*> placement;
+        };
+
+        void WrapCollection(TClonesArray* collection);
+        TraceColumn& WritableTraces();
+        MetadataColumns& WritableMetadata();
+        void ApplyColumns(size_t i, dataProducts::WFD5Waveform& wf) const;
+
+        std::shared_ptr<const std::vector<const dataProducts::WFD5Waveform*>> sources_;
+        std::shared_ptr<TraceColumn> traces_;       // null while the traces are the sources' own
+        std::shared_ptr<MetadataColumns> metadata_; // null while no field has been set
+        std::vector<uint32_t> rows_;                // source row of each row of this batch
+    };
+} //namespace reco
+
+#endif // WAVEFORMBATCH_HH
@@ -10,6 +10,7 @@
 #include "reco/common/ServiceManager.hh"
 #include "reco/wfd5/TemplateLoaderService.hh"
 #include "reco/common/JsonParserUtil.hh"
+#include "reco/wfd5/WaveformBatch.hh"
 
 namespace reco {
 
@@ -26,6 +27,10 @@ namespace reco {
         std::string inputRecoLabel_;
         std::string inputWaveformsLabel_;
         std::string outputWaveformsLabel_;
+        CollectionHandle<dataProducts::WFD5Waveform> inputWaveforms_; //!
+        CollectionHandle<dataProducts::WFD5Waveform> outputWaveforms_; //!
+
+        double defaultFrequency_; // used when the EventStore holds no ODB (e.g. simulated events); 0 = require the ODB
 
         bool debug_;
         bool failOnError_;
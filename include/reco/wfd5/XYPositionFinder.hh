@@ -28,21 +28,27 @@ namespace reco {
         std::string inputRecoLabel_;
         std::string inputFitResultsLabel_;
         std::string outputPositionLabel_;
+        // integrals or fits, depending on the mode
+        CollectionHandle<dataProducts::WaveformIntegral> inputIntegrals_; //!
+        CollectionHandle<dataProducts::WaveformFit> inputFits_; //!
+        CollectionHandle<dataProducts::ClusteredHits> outputPositions_; //!
         bool integrals_;
         bool debug_;
         int weighting_;
         int fitIndex_;
 
-        // Mutable members
-        mutable std::vector<double> xs,ys,weights,energies;
-        mutable double weightSum;
+        // Per-event working state (kept out of the stage so events can be processed concurrently)
+        struct ClusterInputs {
+            std::vector<double> xs,ys,weights,energies;
+            double weightSum;
+        };
 
         bool useFirstFitInFitSequence_,useHighestEnergyFit_;
         bool useFirstFitinTime_;
 
-        void ProcessIntegralsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster) const;
-        void ProcessFitsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster) const;
-        void Cluster(dataProducts::ClusteredHits* thisCluster) const;
+        void ProcessIntegralsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster, ClusterInputs& in) const;
+        void ProcessFitsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster, ClusterInputs& in) const;
+        void Cluster(dataProducts::ClusteredHits* thisCluster, const ClusterInputs& in) const;
 
         ClassDefOverride(XYPositionFinder, 1);
     };
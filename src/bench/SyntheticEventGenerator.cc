@@ -0,0 +1,119 @@
+#include "SyntheticEventGenerator.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+#include <TSpline.h>
+
+using namespace reco;
+
+SyntheticEventGenerator::SyntheticEventGenerator(const nlohmann::json& config, TemplateLoaderService* templates) {
+
+    traceLength_ = config.value("traceLength", 800);
+    pedestal_ = config.value("pedestal", -1700.0);
+    noise_ = config.value("noise", 3.0);
+    pulsesPerTrace_ = config.value("pulsesPerTrace", 1.0);
+    minAmplitude_ = config.value("minAmplitude", 50.0);
+    maxAmplitude_ = config.value("maxAmplitude", 1500.0);
+    minTime_ = config.value("minTime", 50.0);
+    maxTime_ = config.value("maxTime", traceLength_ - 100.0);
+    pileupProbability_ = config.value("pileupProbability", 0.0);
+    pileupWindow_ = config.value("pileupWindow", 5.0);
+    minADC_ = config.value("minADC", -2048);
+    maxADC_ = config.value("maxADC", 2047);
+    rng_.seed(config.value("seed", 12345));
+
+    if (traceLength_ <= 0 || maxTime_ < minTime_) {
+        throw std::runtime_error("SyntheticEventGenerator: invalid trace length or pulse time range");
+    }
+
+    // Channels: listed explicitly as [crate, amc, channel], or the first nChannels that have a template
+    if (config.contains("channels")) {
+        for (const auto& ch : config["channels"]) {
+            channels_.emplace_back(ch.at(0).get<int>(), ch.at(1).get<int>(), ch.at(2).get<int>());
+        }
+    } else {
+        int nChannels = config.value("nChannels", 0);
+        if (templates) {
+            channels_ = templates->GetValidChannels();
+            std::sort(channels_.begin(), channels_.end());
+        } else {
+            int crate = config.value("crateNum", 0);
+            for (int amc = 1; amc < 13; ++amc) {
+                for (int channel = 0; channel < 5; ++channel) channels_.emplace_back(crate, amc, channel);
+            }
+        }
+        if (nChannels > 0 && static_cast<size_t>(nChannels) < channels_.size()) channels_.resize(nChannels);
+    }
+    if (channels_.empty()) {
+        throw std::runtime_error("SyntheticEventGenerator: no channels to generate");
+    }
+
+    // Analytic pulse for channels without a template: Gaussian rise, exponential decay, peak at 0
+    double sigma = config.value("shapeSigma", 1.5);
+    double decay = config.value("shapeDecay", 4.0);
+    Shape analytic{[sigma, decay](double x) {
+                       return x < 0 ? std::exp(-0.5 * x * x / (sigma * sigma)) : std::exp(-x / decay);
+                   },
+                   -5 * sigma, 10 * decay};
+
+    for (const auto& id : channels_) {
+        TSpline3* spline = nullptr;
+        if (templates && templates->GetSplineHolder()->SplinePresent(id)) spline = templates->GetTemplate(id);
+        if (spline) {
+            shapes_.push_back({[spline](double x) { return spline->Eval(x); }, spline->GetXmin(), spline->GetXmax()});
+        } else {
+            shapes_.push_back(analytic);
+        }
+    }
+
+    std::cout << "-> reco::SyntheticEventGenerator: " << channels_.size() << " channels, "
+              << traceLength_ << " samples per trace" << std::endl;
+}
+
+void SyntheticEventGenerator::AddPulse(std::vector<double>& trace, const Shape& shape, double time, double amplitude) const {
+    int first = std::max(0, static_cast<int>(std::ceil(time + shape.xmin)));
+    int last = std::min(static_cast<int>(trace.size()) - 1, static_cast<int>(std::floor(time + shape.xmax)));
+    for (int i = first; i <= last; ++i) {
+        trace[i] += amplitude * shape.eval(i - time);
+    }
+}
+
+dataProducts::DataProductPtrCollection SyntheticEventGenerator::Generate(int eventNum) {
+    std::normal_distribution<double> noise(0.0, noise_);
+    std::poisson_distribution<int> nPulses(pulsesPerTrace_);
+    std::uniform_real_distribution<double> amplitude(minAmplitude_, maxAmplitude_);
+    std::uniform_real_distribution<double> time(minTime_, maxTime_);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    dataProducts::DataProductPtrCollection waveforms;
+    waveforms.reserve(channels_.size());
+    std::vector<double> trace(traceLength_);
+
+    for (size_t c = 0; c < channels_.size(); ++c) {
+        std::fill(trace.begin(), trace.end(), pedestal_);
+        int n = pulsesPerTrace_ > 0 ? nPulses(rng_) : 0;
+        for (int p = 0; p < n; ++p) {
+            double t = time(rng_);
+            AddPulse(trace, shapes_[c], t, amplitude(rng_));
+            if (uniform(rng_) < pileupProbability_) {
+                AddPulse(trace, shapes_[c], t + pileupWindow_ * uniform(rng_), amplitude(rng_));
+            }
+        }
+
+        auto waveform = std::make_shared<dataProducts::WFD5Waveform>();
+        std::tie(waveform->crateNum, waveform->amcNum, waveform->channelTag) = channels_[c];
+        waveform->eventNum = eventNum;
+        waveform->waveformIndex = 0;
+        waveform->length = traceLength_;
+        waveform->trace.resize(traceLength_);
+        for (int i = 0; i < traceLength_; ++i) {
+            double adc = std::round(trace[i] + (noise_ > 0 ? noise(rng_) : 0.0));
+            waveform->trace[i] = static_cast<short>(std::clamp(adc, double(minADC_), double(maxADC_)));
+        }
+        waveforms.push_back(waveform);
+    }
+    return waveforms;
+}
@@ -0,0 +1,61 @@
+#ifndef SYNTHETICEVENTGENERATOR_HH
+#define SYNTHETICEVENTGENERATOR_HH
+
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <data_products/common/DataProduct.hh>
+#include <data_products/wfd5/WFD5Waveform.hh>
+
+#include "reco/wfd5/TemplateLoaderService.hh"
+
+namespace reco {
+
+    // Makes WFD5 events for the benchmark: one waveform per channel, with a pedestal, Gaussian noise
+    // and a random number of pulses drawn from the channel's template (or a simple analytic shape when
+    // no templates are given), optional pileup and clipping at the ADC range.
+    // The same seed gives the same events.
+    class SyntheticEventGenerator {
+    public:
+        // templates may be null; the channels are then taken from the config only
+        SyntheticEventGenerator(const nlohmann::json& config, TemplateLoaderService* templates);
+
+        // The waveforms of the next event
+        dataProducts::DataProductPtrCollection Generate(int eventNum);
+
+        const dataProducts::ChannelList& GetChannels() const { return channels_; }
+
+    private:
+        // Pulse of unit amplitude as a function of the sample relative to the pulse time, zero outside [xmin, xmax]
+        struct Shape {
+            std::function<double(double)> eval;
+            double xmin;
+            double xmax;
+        };
+
+        void AddPulse(std::vector<double>& trace, const Shape& shape, double time, double amplitude) const;
+
+        dataProducts::ChannelList channels_;
+        std::vector<Shape> shapes_; // per channel
+
+        int traceLength_;
+        double pedestal_;
+        double noise_;
+        double pulsesPerTrace_;
+        double minAmplitude_;
+        double maxAmplitude_;
+        double minTime_;
+        double maxTime_;
+        double pileupProbability_;
+        double pileupWindow_;
+        int minADC_;
+        int maxADC_;
+
+        std::mt19937_64 rng_;
+    };
+}
+
+#endif // SYNTHETICEVENTGENERATOR_HH
@@ -0,0 +1,128 @@
+// Throughput benchmark: runs the reconstruction of a standard JSON config over synthetic WFD5 events.
+//
+//   reco_bench <config.json> [output.root]
+//
+// The "Bench" block of the config sets the number of events and the shape of the generated
+// waveforms (see SyntheticEventGenerator). Per-stage latency percentiles are printed by the
+// reco::TimeProfilerService when the config includes one.
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <sys/resource.h>
+
+#include "reco/common/ConfigHolder.hh"
+#include "reco/common/EventStore.hh"
+#include "reco/common/ParallelEventProcessor.hh"
+#include "reco/common/RecoManager.hh"
+#include "reco/common/ServiceManager.hh"
+#include "reco/common/TimeProfilerService.hh"
+#include "reco/wfd5/TemplateLoaderService.hh"
+#include "reco/wfd5/WFD5OutputManager.hh"
+
+#include "SyntheticEventGenerator.hh"
+
+namespace {
+
+    // Peak resident set size of the process in MB
+    double PeakRSS() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+        return usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <config.json> [output.root]" << std::endl;
+        return 1;
+    }
+    std::string configFile = argv[1];
+    std::string outputFile = argc > 2 ? argv[2] : "reco_bench.root";
+
+    try {
+        auto configHolder = std::make_shared<reco::ConfigHolder>();
+        configHolder->LoadFromFile(configFile);
+        const nlohmann::json bench = configHolder->GetConfig().value("Bench", nlohmann::json::object());
+
+        int nEvents = bench.value("nEvents", 1000);
+        // Events are generated up front (outside the timing) and then reused in turn
+        int nDistinctEvents = std::max(1, std::min(nEvents, bench.value("distinctEvents", 100)));
+        std::string inputRecoLabel = bench.value("inputRecoLabel", "unpacker");
+        std::string inputWaveformsLabel = bench.value("inputWaveformsLabel", "WFD5WaveformCollection");
+
+        // The IOV services look up their files with the run number
+        configHolder->SetRunSubrun(bench.value("run", 0), bench.value("subrun", 0));
+        auto eventStore = std::make_shared<reco::EventStore>();
+        eventStore->SetRunSubrun(configHolder->GetRun(), configHolder->GetSubrun());
+
+        auto serviceManager = std::make_shared<reco::ServiceManager>();
+        serviceManager->Configure(configHolder, *eventStore);
+
+        auto recoManager = std::make_shared<reco::RecoManager>();
+        recoManager->Configure(configHolder, *serviceManager, *eventStore);
+
+        auto outputManager = std::make_shared<reco::WFD5OutputManager>(outputFile);
+        outputManager->Configure(configHolder);
+
+        std::shared_ptr<reco::TemplateLoaderService> templates;
+        if (bench.contains("templateServiceLabel")) {
+            templates = serviceManager->Get<reco::TemplateLoaderService>(bench["templateServiceLabel"]);
+            if (!templates) {
+                throw std::runtime_error("reco_bench: '" + bench["templateServiceLabel"].get<std::string>() + "' is not a TemplateLoaderService");
+            }
+        }
+
+        reco::SyntheticEventGenerator generator(bench, templates.get());
+        std::vector<dataProducts::DataProductPtrCollection> events;
+        events.reserve(nDistinctEvents);
+        for (int i = 0; i < nDistinctEvents; ++i) {
+            events.push_back(generator.Generate(i));
+        }
+
+        std::cout << "-> reco_bench: Processing " << nEvents << " events (" << nDistinctEvents << " distinct)" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        reco::ParallelEventProcessor processor(*recoManager, *serviceManager, *outputManager, *eventStore);
+        for (int i = 0; i < nEvents; ++i) {
+            const auto& waveforms = events[i % nDistinctEvents];
+            processor.Submit([&waveforms, &inputRecoLabel, &inputWaveformsLabel](reco::EventStore& store) {
+                store.put<dataProducts::WFD5Waveform>(inputRecoLabel, inputWaveformsLabel, waveforms);
+            });
+        }
+        processor.Finish();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        outputManager->WriteHistograms(*eventStore);
+        serviceManager->EndOfJobPrint();
+
+        bool profiled = false;
+        for (const auto& [_, service] : serviceManager->GetServices()) {
+            profiled |= static_cast<bool>(std::dynamic_pointer_cast<reco::TimeProfilerService>(service));
+        }
+        if (!profiled) {
+            std::cout << "-> reco_bench: Add a reco::TimeProfilerService to the config for the per-stage latencies" << std::endl;
+        }
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "-> reco_bench: " << nEvents << " events, " << generator.GetChannels().size() << " channels, "
+                  << processor.GetNThreads() << " thread(s)\n"
+                  << "   wall time:  " << seconds << " s\n"
+                  << "   throughput: " << (seconds > 0 ? nEvents / seconds : 0.0) << " events/s\n"
+                  << "   peak RSS:   " << PeakRSS() << " MB" << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "reco_bench: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
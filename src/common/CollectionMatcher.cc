@@ -0,0 +1,53 @@
+#include "reco/common/CollectionMatcher.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace reco;
+
+CollectionMatcher::CollectionMatcher(const std::vector<std::string>& patterns) {
+    static const std::string regexPrefix = "regex:";
+    for (const auto& pattern : patterns) {
+        if (pattern.compare(0, regexPrefix.size(), regexPrefix) == 0) {
+            try {
+                regexes_.emplace_back(pattern.substr(regexPrefix.size()), std::regex::ECMAScript | std::regex::optimize);
+            } catch (const std::regex_error& e) {
+                throw std::runtime_error("CollectionMatcher: Invalid regular expression '" + pattern + "': " + e.what());
+            }
+        } else if (pattern.find_first_of("*?") == std::string::npos) {
+            exact_.insert(pattern);
+        } else {
+            globs_.push_back(pattern);
+        }
+    }
+}
+
+bool CollectionMatcher::Matches(const std::string& name) const {
+    if (exact_.count(name)) return true;
+    if (std::any_of(globs_.begin(), globs_.end(), [&](const std::string& glob) { return MatchesGlob(glob, name); })) {
+        return true;
+    }
+    return std::any_of(regexes_.begin(), regexes_.end(), [&](const std::regex& re) { return std::regex_match(name, re); });
+}
+
+bool CollectionMatcher::MatchesGlob(const std::string& pattern, const std::string& text) {
+    // Greedy match that backtracks to the last '*' on a mismatch
+    size_t p = 0, t = 0;
+    size_t star = std::string::npos, starText = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            ++p;
+            ++t;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            starText = t;
+        } else if (star != std::string::npos) {
+            p = star + 1;
+            t = ++starText;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
@@ -1,5 +1,86 @@
 #include "reco/common/EventStore.hh"
 
-// Only non-template methods (if any) go here.
-// In this case, all non-template methods are inline in the header,
-// so this file can be empty or removed.
+#include <TH1.h>
+
+using namespace reco;
+
+// Template methods are inline in the header; only the batch and replica helpers live here.
+
+TClonesArray* EventStore::Materialize(const std::string& label, const EventBatch& batch) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = buffers_.find(label);
+    TClonesArray* arr = nullptr;
+    if (it == buffers_.end()) {
+        arr = new TClonesArray(batch.GetElementClass()->GetName());
+        buffers_[label] = arr;
+        bufferKeys_.push_back(label);
+        if (auto* slot = FindSlot(label)) slot->buffer = arr;
+        std::cout << "-> reco::EventStore: Created TClonesArray for '" << label << "' (from batch)." << std::endl;
+    } else {
+        arr = it->second;
+    }
+    if (materialized_.insert(label).second) {
+        arr->Clear("C");
+        batch.Materialize(*arr);
+    }
+    return arr;
+}
+
+void EventStore::alias(const std::string& reco_label, const std::string& data_label,
+                       const std::string& target_reco, const std::string& target_data) {
+    std::string label = MakeLabel(reco_label, data_label);
+    std::string target = GetLabel(target_reco, target_data);
+    if (label == target) {
+        throw std::runtime_error("Collection cannot be an alias of itself: " + label);
+    }
+    if (aliases_.count(label) || buffers_.count(label) || batches_.count(label) || slotIndex_.count(label)) {
+        throw std::runtime_error("Cannot make an alias, the label is already in use: " + label);
+    }
+    // Keep aliases pointing straight at a stored label
+    for (auto& [name, stored] : aliases_) {
+        if (stored == label) stored = target;
+    }
+    aliases_[label] = target;
+    std::cout << "-> reco::EventStore: '" << label << "' is an alias of '" << target << "'." << std::endl;
+}
+
+void EventStore::MaterializeBatches(const std::function<bool(const std::string&)>& wanted) {
+    for (const auto& label : batchKeys_) {
+        const EventBatch& batch = *batches_.at(label);
+        if (!batch.IsView() && wanted(label)) {
+            Materialize(label, batch);
+        }
+    }
+}
+
+std::unique_ptr<EventStore> EventStore::MakeReplica() const {
+    auto replica = std::make_unique<EventStore>();
+    replica->SetConditions(GetConditions());
+    replica->splines_ = splines_;
+    replica->aliases_ = aliases_;
+
+    // Same handle indices, but the replica's collections are its own
+    replica->slotIndex_ = slotIndex_;
+    replica->slotClasses_ = slotClasses_;
+    replica->slots_.assign(slots_.size(), CollectionSlot());
+
+    // Histograms are filled per event, so each replica gets its own copy to fill
+    for (const auto& [name, hist] : histograms_) {
+        std::shared_ptr<TH1> clone(static_cast<TH1*>(hist->Clone()));
+        clone->SetDirectory(nullptr);
+        clone->Reset();
+        replica->histograms_[name] = clone;
+    }
+    return replica;
+}
+
+void EventStore::MergeHistograms(const EventStore& replica) {
+    for (const auto& [name, hist] : replica.histograms_) {
+        auto it = histograms_.find(name);
+        if (it == histograms_.end()) {
+            std::cerr << "Warning: Histogram " << name << " not found in the event store; not merging.\n";
+            continue;
+        }
+        it->second->Add(hist.get());
+    }
+}
@@ -0,0 +1,110 @@
+#include "reco/common/FlatTreeWriter.hh"
+
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <TClonesArray.h>
+#include <TDataMember.h>
+#include <TRealData.h>
+
+using namespace reco;
+
+FlatTreeWriter::FlatTreeWriter(const std::string& treeName, const std::string& collection, const std::vector<std::string>& fields)
+    : collection_(collection),
+      columns_(fields.size()),
+      tree_(new TTree(treeName.c_str(), ("Flat columns of " + collection).c_str())) {
+    if (fields.empty()) {
+        throw std::runtime_error("FlatTreeWriter: No fields given for '" + treeName + "'");
+    }
+    for (size_t i = 0; i < fields.size(); ++i) {
+        columns_[i].field = fields[i];
+    }
+    tree_->Branch("run", &run_, "run/I");
+    tree_->Branch("subrun", &subrun_, "subrun/I");
+    tree_->Branch("event", &event_, "event/L");
+}
+
+void FlatTreeWriter::Fill(const EventStore& eventStore, Long64_t event) {
+    const auto& buffers = eventStore.GetBuffers();
+    auto it = buffers.find(collection_);
+    if (it == buffers.end() || !it->second) {
+        return;
+    }
+    TClonesArray* collection = it->second;
+    if (!bound_) {
+        Bind(collection->GetClass());
+    }
+
+    run_ = eventStore.GetRun();
+    subrun_ = eventStore.GetSubrun();
+    event_ = event;
+    for (int i = 0; i < collection->GetEntriesFast(); ++i) {
+        // The data products derive from TObject first, so the object starts at the TObject
+        const char* object = reinterpret_cast<const char*>(collection->At(i));
+        for (auto& column : columns_) {
+            const char* field = object + column.offset;
+            switch (column.kind) {
+                case Kind::kVectorInt: column.vectorInt = *reinterpret_cast<const std::vector<int>*>(field); break;
+                case Kind::kVectorShort: column.vectorShort = *reinterpret_cast<const std::vector<short>*>(field); break;
+                case Kind::kVectorFloat: column.vectorFloat = *reinterpret_cast<const std::vector<float>*>(field); break;
+                case Kind::kVectorDouble: column.vectorDouble = *reinterpret_cast<const std::vector<double>*>(field); break;
+                default: std::memcpy(column.value, field, column.size); break;
+            }
+        }
+        tree_->Fill();
+    }
+}
+
+void FlatTreeWriter::Write() {
+    tree_->Write();
+}
+
+void FlatTreeWriter::Bind(TClass* elementClass) {
+    for (auto& column : columns_) {
+        TRealData* realData = elementClass->GetRealData(column.field.c_str());
+        if (!realData || !realData->GetDataMember()) {
+            throw std::runtime_error("FlatTreeWriter: '" + std::string(elementClass->GetName()) + "' has no field '" + column.field + "'");
+        }
+        TDataMember* member = realData->GetDataMember();
+        if (member->IsaPointer() || member->GetArrayDim() > 0) {
+            throw std::runtime_error("FlatTreeWriter: Field '" + column.field + "' is a pointer or an array");
+        }
+
+        char leafType = 0;
+        column.kind = ParseKind(member->GetTrueTypeName(), column.size, leafType);
+        column.offset = realData->GetThisOffset();
+
+        switch (column.kind) {
+            case Kind::kVectorInt: tree_->Branch(column.field.c_str(), &column.vectorInt); break;
+            case Kind::kVectorShort: tree_->Branch(column.field.c_str(), &column.vectorShort); break;
+            case Kind::kVectorFloat: tree_->Branch(column.field.c_str(), &column.vectorFloat); break;
+            case Kind::kVectorDouble: tree_->Branch(column.field.c_str(), &column.vectorDouble); break;
+            default:
+                tree_->Branch(column.field.c_str(), column.value, (column.field + "/" + leafType).c_str());
+                break;
+        }
+    }
+    bound_ = true;
+    std::cout << "-> reco::FlatTreeWriter: Writing " << columns_.size() << " fields of '" << collection_
+              << "' to tree '" << tree_->GetName() << "'." << std::endl;
+}
+
+FlatTreeWriter::Kind FlatTreeWriter::ParseKind(const std::string& typeName, size_t& size, char& leafType) {
+    std::string type = typeName;
+    for (size_t pos; (pos = type.find("std::")) != std::string::npos;) type.erase(pos, 5);
+
+    if (type == "int") { size = sizeof(int); leafType = 'I'; return Kind::kInt; }
+    if (type == "unsigned int") { size = sizeof(unsigned int); leafType = 'i'; return Kind::kUInt; }
+    if (type == "short") { size = sizeof(short); leafType = 'S'; return Kind::kShort; }
+    if (type == "long" || type == "long long") { size = sizeof(Long64_t); leafType = 'L'; return Kind::kLong64; }
+    if (type == "unsigned long" || type == "unsigned long long") { size = sizeof(ULong64_t); leafType = 'l'; return Kind::kULong64; }
+    if (type == "float") { size = sizeof(float); leafType = 'F'; return Kind::kFloat; }
+    if (type == "double") { size = sizeof(double); leafType = 'D'; return Kind::kDouble; }
+    if (type == "bool") { size = sizeof(bool); leafType = 'O'; return Kind::kBool; }
+    if (type == "vector<int>") return Kind::kVectorInt;
+    if (type == "vector<short>") return Kind::kVectorShort;
+    if (type == "vector<float>") return Kind::kVectorFloat;
+    if (type == "vector<double>") return Kind::kVectorDouble;
+    throw std::runtime_error("FlatTreeWriter: Unsupported field type '" + typeName + "'");
+}
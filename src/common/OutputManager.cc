@@ -1,5 +1,8 @@
 #include "reco/common/OutputManager.hh"
 
+#include <Compression.h>
+#include <TROOT.h>
+
 using namespace reco;
 
 OutputManager::OutputManager(const std::string& filename)
@@ -11,6 +14,9 @@ OutputManager::OutputManager(const std::string& filename)
 reco::OutputManager::~OutputManager() {
     file_->cd();
     tree_->Write();
+    for (auto& flatTree : flatTrees_) {
+        flatTree->Write();
+    }
     file_->Close();
 }
 
@@ -39,6 +45,29 @@ void OutputManager::Configure(std::shared_ptr<const ConfigHolder> configHolder)
         throw std::runtime_error("OutputManager: 'drop' must be an array in 'Output' config");
     }
 
+    keepList_.clear();
+    if (config["Output"].contains("keep")) {
+        if (!config["Output"]["keep"].is_array()) {
+            throw std::runtime_error("OutputManager: 'keep' must be an array in 'Output' config");
+        }
+        for (const auto& colName : config["Output"]["keep"]) {
+            if (!colName.is_string()) {
+                throw std::runtime_error("OutputManager: 'keep' must be an array of strings");
+            }
+            keepList_.push_back(colName.get<std::string>());
+        }
+        std::cout << "-> OutputManager: Collections to keep: ";
+        for (const auto& colName : keepList_) {
+            std::cout << colName << " ";
+        }
+        std::cout << std::endl;
+    }
+
+    dropMatcher_ = CollectionMatcher(dropList_);
+    keepMatcher_ = CollectionMatcher(keepList_);
+    dropped_.clear();
+    boundStore_ = nullptr;
+
     if (config["Output"].contains("compressionLevel") && config["Output"]["compressionLevel"].is_number_integer()) {
         compressionLevel_ = config["Output"]["compressionLevel"].get<int>();
     } else {
@@ -60,6 +89,71 @@ void OutputManager::Configure(std::shared_ptr<const ConfigHolder> configHolder)
     // outfile->SetCompressionLevel(0); // much faster, but the file size doubles (62->137 MB), 2.936s
     // outfile->SetCompressionAlgorithm(4); // LZ4. 40-50% faster, but slightly larger file sizes. 3.292s, 91MB
 
+    // Per-collection settings, e.g. LZ4 for the fit results and ZSTD for the waveforms
+    branchRules_.clear();
+    if (config["Output"].contains("branchRules")) {
+        if (!config["Output"]["branchRules"].is_array()) {
+            throw std::runtime_error("OutputManager: 'branchRules' must be an array in 'Output' config");
+        }
+        for (const auto& ruleConfig : config["Output"]["branchRules"]) {
+            if (!ruleConfig.contains("match") || !ruleConfig["match"].is_string()) {
+                throw std::runtime_error("OutputManager: every entry of 'branchRules' needs a 'match' pattern");
+            }
+            BranchRule rule;
+            rule.match = CollectionMatcher({ruleConfig["match"].get<std::string>()});
+            rule.compressionAlgorithm = ruleConfig.value("compressionAlgorithm", -1);
+            rule.compressionLevel = ruleConfig.value("compressionLevel", -1);
+            rule.basketSize = ruleConfig.value("basketSize", -1);
+            branchRules_.push_back(std::move(rule));
+        }
+        std::cout << "-> reco::OutputManager: " << branchRules_.size() << " branch rules." << std::endl;
+    }
+
+    // Entries per cluster of baskets (a TTree setting, so it applies to every branch)
+    if (config["Output"].contains("autoFlush")) {
+        tree_->SetAutoFlush(config["Output"]["autoFlush"].get<Long64_t>());
+    }
+
+    // Selected fields as plain columns, readable without the reco dictionary
+    flatTrees_.clear();
+    flatCollections_.clear();
+    if (config["Output"].contains("flatTrees")) {
+        if (!config["Output"]["flatTrees"].is_array()) {
+            throw std::runtime_error("OutputManager: 'flatTrees' must be an array in 'Output' config");
+        }
+        file_->cd();
+        for (const auto& flatConfig : config["Output"]["flatTrees"]) {
+            if (!flatConfig.contains("name") || !flatConfig.contains("collection") || !flatConfig.contains("fields")) {
+                throw std::runtime_error("OutputManager: every entry of 'flatTrees' needs 'name', 'collection' and 'fields'");
+            }
+            std::string collection = flatConfig["collection"].get<std::string>();
+            flatTrees_.push_back(std::make_unique<FlatTreeWriter>(flatConfig["name"].get<std::string>(), collection,
+                                                                  flatConfig["fields"].get<std::vector<std::string>>()));
+            flatCollections_.insert(collection);
+        }
+    }
+
+    // Take Fill (and the compression it does) off the event loop
+    asyncWriter_ = config["Output"].value("asyncWriter", false);
+    writerQueueDepth_ = config["Output"].value("writerQueueDepth", 2);
+    if (writerQueueDepth_ < 1) {
+        throw std::runtime_error("OutputManager: 'writerQueueDepth' must be at least 1");
+    }
+    if (asyncWriter_) {
+        std::cout << "-> reco::OutputManager: Events will be written on a separate thread (queue depth "
+                  << writerQueueDepth_ << ")." << std::endl;
+    }
+
+    // With implicit multi-threading, TTree::Fill compresses the baskets of different branches in parallel
+    compressionThreads_ = config["Output"].value("compressionThreads", 0);
+    if (compressionThreads_ > 0) {
+        ROOT::EnableImplicitMT(compressionThreads_);
+        tree_->SetImplicitMT(true);
+        std::cout << "-> reco::OutputManager: Baskets will be compressed on " << compressionThreads_ << " threads." << std::endl;
+    }
+
+    ConfigureOutput(config["Output"]);
+
     //Write the configuration to the file
     dataProducts::RecoConfig recoConfig(config.dump(),configHolder->GetRun(),configHolder->GetSubrun());
     file_->cd();
@@ -67,38 +161,82 @@ void OutputManager::Configure(std::shared_ptr<const ConfigHolder> configHolder)
 }
 
 
+bool OutputManager::IsDropped(const std::string& collName) const {
+    std::lock_guard<std::mutex> lock(droppedMutex_);
+    auto it = dropped_.find(collName);
+    if (it == dropped_.end()) {
+        bool dropped = dropMatcher_.Matches(collName) && !keepMatcher_.Matches(collName);
+        it = dropped_.emplace(collName, dropped).first;
+    }
+    return it->second;
+}
+
+void OutputManager::MaterializeForOutput(EventStore& eventStore) const {
+    eventStore.MaterializeBatches([this](const std::string& label) {
+        return !IsDropped(label) || flatCollections_.count(label);
+    });
+}
+
 // Fill the event data from EventStore to the TTree
-void OutputManager::FillEvent(const EventStore& eventStore) {
-   
-    // Get the buffers
-    auto buffers = eventStore.GetBuffers();
-    auto bufferKeys = eventStore.GetBufferKeys();
+void OutputManager::FillEvent(EventStore& eventStore) {
+
+    MaterializeForOutput(eventStore);
+
+    // The collections of a store are reused from event to event, so the branches
+    // still point at the right arrays unless something changed
+    if (&eventStore != boundStore_ || eventStore.GetBufferKeys().size() != boundKeys_) {
+        BindStore(eventStore);
+    }
+
+    // Fill the tree
+    PrepareFill(eventStore);
+    tree_->Fill();
+    FinishFill();
+
+    for (auto& flatTree : flatTrees_) {
+        flatTree->Fill(eventStore, tree_->GetEntries() - 1);
+    }
+ }
+
+void OutputManager::BindStore(const EventStore& eventStore) {
+    const auto& buffers = eventStore.GetBuffers();
+    const auto& bufferKeys = eventStore.GetBufferKeys();
 
     // Loop over buffer keys and create the branches
     for (const auto& collName : bufferKeys) {
         
-        const auto& buffer = buffers.at(collName);
+        TClonesArray* buffer = buffers.at(collName);
         if (!buffer) {
             std::cerr << "-> reco::WFD5OutputManager: No buffer found for collection '" << collName << "'." << std::endl;
             continue;
         }
 
-        if (std::any_of(dropList_.begin(), dropList_.end(),
-            [&](const std::string& pattern) {   // capture collName by value, NOT &
-                return MatchesWildcard(pattern, collName);
-            })) {
+        if (IsDropped(collName)) {
             continue;
         }
         CreateBranchIfMissing(collName, buffer);
     }
 
+    // Point branches of collections this EventStore never created at an empty array,
+    // otherwise they would still read another EventStore's collection
+    for (auto& [name, slot] : branchBuffers_) {
+        if (buffers.count(name)) continue;
+        auto& empty = emptyBuffers_[name];
+        if (!empty) {
+            empty = std::make_unique<TClonesArray>(slot->GetClass()->GetName());
+        }
+        if (slot != empty.get()) {
+            slot = empty.get();
+            tree_->SetBranchAddress(name.c_str(), &slot);
+        }
+    }
+
     // Ensure TRefs work
     tree_->BranchRef();
 
-    // Fill the tree
-    tree_->Fill();
-
- }
+    boundStore_ = &eventStore;
+    boundKeys_ = bufferKeys.size();
+}
 
 
 bool OutputManager::StartsWith(const std::string& str, const std::string& prefix) {
@@ -112,20 +250,7 @@ bool OutputManager::EndsWith(const std::string& str, const std::string& suffix)
 }
 
 bool OutputManager::MatchesWildcard(const std::string& pattern, const std::string& text) {
-    if (pattern == "*") return true;
-
-    auto starPos = pattern.find('*');
-    if (starPos == std::string::npos) {
-        return pattern == text;
-    }
-
-    std::string prefix = pattern.substr(0, starPos);
-    std::string suffix = pattern.substr(starPos + 1);
-
-    if (!prefix.empty() && !StartsWith(text, prefix)) return false;
-    if (!suffix.empty() && !EndsWith(text, suffix)) return false;
-
-    return true;
+    return CollectionMatcher::MatchesGlob(pattern, text);
 }
 
 // Write splines
@@ -138,21 +263,55 @@ void OutputManager::WriteSplines(const EventStore& store) {
 }
 
 // Write histograms
-void OutputManager::WriteHistograms(const EventStore& store) {
+void OutputManager::WriteHistograms(EventStore& store) {
+    store.RunEndOfJob();
     for (const auto& [name, hist] : store.GetAllHistograms()) {
         file_->cd();
         hist->Write(name.c_str());
         std::cout << "-> reco::OutputManager: Wrote histogram '" << name << "' to the TFile." << std::endl;
     }
+    for (const auto& [name, object] : store.GetAllObjects()) {
+        file_->cd();
+        object->Write(name.c_str());
+        std::cout << "-> reco::OutputManager: Wrote object '" << name << "' to the TFile." << std::endl;
+    }
 }
 
 
 // protected:
 
+const OutputManager::BranchRule* OutputManager::FindBranchRule(const std::string& name) const {
+    for (const auto& rule : branchRules_) {
+        if (rule.match.Matches(name)) return &rule;
+    }
+    return nullptr;
+}
+
 // Helper to create branch if missing
 void OutputManager::CreateBranchIfMissing(const std::string& name, TClonesArray* buffer) {
-    if (!tree_->GetBranch(name.c_str())) {
-        tree_->Branch(name.c_str(), &buffer);
-        std::cout << "-> reco::OutputManager: Created branch '" << name << "' in tree." << std::endl;
+    auto it = branchBuffers_.find(name);
+    if (it == branchBuffers_.end()) {
+        // The branch keeps the address of the slot, so the slot must outlive the tree
+        it = branchBuffers_.emplace(name, buffer).first;
+        const BranchRule* rule = FindBranchRule(name);
+        int basketSize = rule && rule->basketSize > 0 ? rule->basketSize : 32000;
+        TBranch* branch = tree_->Branch(name.c_str(), &it->second, basketSize);
+        if (rule && (rule->compressionAlgorithm >= 0 || rule->compressionLevel >= 0)) {
+            // Also applies to the sub-branches of the split collection
+            int algorithm = rule->compressionAlgorithm >= 0 ? rule->compressionAlgorithm : compressionAlgorithm_;
+            int level = rule->compressionLevel >= 0 ? rule->compressionLevel : compressionLevel_;
+            branch->SetCompressionSettings(ROOT::CompressionSettings(
+                static_cast<ROOT::RCompressionSetting::EAlgorithm::EValues>(algorithm), level));
+            std::cout << "-> reco::OutputManager: Created branch '" << name << "' in tree (compression algorithm "
+                      << algorithm << ", level " << level << ", basket size " << basketSize << ")." << std::endl;
+        } else {
+            std::cout << "-> reco::OutputManager: Created branch '" << name << "' in tree." << std::endl;
+        }
+
+        BranchCreated(name, buffer);
+    } else if (it->second != buffer) {
+        // Filling from a different EventStore (e.g. a worker replica)
+        it->second = buffer;
+        tree_->SetBranchAddress(name.c_str(), &it->second);
     }
 }
\ No newline at end of file
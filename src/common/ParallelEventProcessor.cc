@@ -0,0 +1,231 @@
+#include "reco/common/ParallelEventProcessor.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <TROOT.h>
+
+using namespace reco;
+
+ParallelEventProcessor::ParallelEventProcessor(RecoManager& recoManager, const ServiceManager& serviceManager,
+                                               OutputManager& outputManager, EventStore& eventStore)
+    : recoManager_(recoManager),
+      serviceManager_(serviceManager),
+      outputManager_(outputManager),
+      eventStore_(eventStore),
+      nThreads_(recoManager.GetNThreads()),
+      queueDepth_(std::max(1, recoManager.GetEventQueueDepth())) {
+
+    if (nThreads_ <= 1 && !outputManager_.IsAsync()) {
+        return;
+    }
+
+    // ROOT must be told before objects are created/streamed from several threads
+    ROOT::EnableThreadSafety();
+
+    // One replica per worker plus one per queued event, so workers never wait on the writer.
+    // Without workers, one for the event being reconstructed plus the events waiting to be written.
+    size_t nReplicas = nThreads_ > 1 ? nThreads_ + queueDepth_ : outputManager_.GetWriterQueueDepth() + 1;
+    for (size_t i = 0; i < nReplicas; ++i) {
+        replicas_.push_back(eventStore_.MakeReplica());
+        freeStores_.push_back(replicas_.back().get());
+    }
+
+    if (nThreads_ > 1) {
+        for (int i = 0; i < nThreads_; ++i) {
+            workers_.emplace_back(&ParallelEventProcessor::WorkerLoop, this);
+        }
+    }
+    writer_ = std::thread(&ParallelEventProcessor::WriterLoop, this);
+
+    std::cout << "-> reco::ParallelEventProcessor: Started " << workers_.size() << " worker threads and a writer thread with "
+              << nReplicas << " EventStore replicas." << std::endl;
+}
+
+ParallelEventProcessor::~ParallelEventProcessor() {
+    try {
+        Finish();
+    } catch (const std::exception& e) {
+        std::cerr << "-> reco::ParallelEventProcessor: Error while finishing: " << e.what() << std::endl;
+    }
+}
+
+void ParallelEventProcessor::Submit(EventLoader loader) {
+    if (finished_) {
+        throw std::runtime_error("ParallelEventProcessor: Submit called after Finish");
+    }
+
+    // Serial mode: same as the usual loop on the main EventStore
+    if (replicas_.empty()) {
+        loader(eventStore_);
+        recoManager_.Run(eventStore_, serviceManager_);
+        outputManager_.FillEvent(eventStore_);
+        eventStore_.clear();
+        return;
+    }
+
+    if (workers_.empty()) {
+        SubmitInline(std::move(loader));
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        spaceCv_.wait(lock, [&] { return jobs_.size() < queueDepth_ || failure_; });
+        if (failure_) {
+            lock.unlock();
+            RethrowIfFailed();
+        }
+        jobs_.push_back({nSubmitted_++, std::move(loader), eventStore_.GetConditions()});
+    }
+    workCv_.notify_one();
+}
+
+void ParallelEventProcessor::Finish() {
+    if (finished_) return;
+    finished_ = true;
+
+    if (!replicas_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        workCv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+        writerCv_.notify_all();
+        writer_.join();
+
+        // Collect what the workers filled into the main EventStore's histograms
+        for (const auto& replica : replicas_) {
+            eventStore_.MergeHistograms(*replica);
+        }
+    }
+
+    RethrowIfFailed();
+    recoManager_.EndOfJob(eventStore_);
+}
+
+// Reconstruct on the calling thread, write on the writer thread
+void ParallelEventProcessor::SubmitInline(EventLoader loader) {
+    EventStore* store = nullptr;
+    uint64_t seq = 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        spaceCv_.wait(lock, [&] { return !freeStores_.empty() || failure_; });
+        if (failure_) {
+            lock.unlock();
+            RethrowIfFailed();
+        }
+        store = freeStores_.back();
+        freeStores_.pop_back();
+        seq = nSubmitted_++;
+    }
+
+    try {
+        store->SetConditions(eventStore_.GetConditions());
+        loader(*store);
+        recoManager_.Run(*store, serviceManager_);
+        outputManager_.MaterializeForOutput(*store);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!failure_) failure_ = std::current_exception();
+    }
+
+    // Handed to the writer even if it failed, so the replica is cleared and returned
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        completed_[seq] = store;
+    }
+    writerCv_.notify_one();
+    RethrowIfFailed();
+}
+
+void ParallelEventProcessor::WorkerLoop() {
+    while (true) {
+        Job job;
+        EventStore* store = nullptr;
+        bool skip = false;
+        {
+            // Take the job and a replica together: jobs are then always started in submission
+            // order, so the event the writer is waiting for can never be starved of a replica
+            std::unique_lock<std::mutex> lock(mutex_);
+            workCv_.wait(lock, [&] { return (!jobs_.empty() && !freeStores_.empty()) || (stopping_ && jobs_.empty()); });
+            if (jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+            store = freeStores_.back();
+            freeStores_.pop_back();
+            skip = static_cast<bool>(failure_);
+        }
+        spaceCv_.notify_one();
+
+        try {
+            if (!skip) {
+                store->SetConditions(job.conditions);
+                job.loader(*store);
+                recoManager_.Run(*store, serviceManager_);
+                // Build the output collections here rather than on the writer thread
+                outputManager_.MaterializeForOutput(*store);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!failure_) failure_ = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            completed_[job.seq] = store;
+        }
+        writerCv_.notify_one();
+    }
+}
+
+void ParallelEventProcessor::WriterLoop() {
+    while (true) {
+        EventStore* store = nullptr;
+        bool failed = false;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            writerCv_.wait(lock, [&] {
+                return completed_.count(nextToWrite_) || (stopping_ && nextToWrite_ == nSubmitted_);
+            });
+            auto it = completed_.find(nextToWrite_);
+            if (it == completed_.end()) return;
+            store = it->second;
+            completed_.erase(it);
+            failed = static_cast<bool>(failure_);
+        }
+
+        // Once an event has failed nothing more is written, as in the serial loop
+        if (!failed) {
+            try {
+                outputManager_.FillEvent(*store);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!failure_) failure_ = std::current_exception();
+            }
+        }
+        store->clear();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            freeStores_.push_back(store);
+            ++nextToWrite_;
+        }
+        workCv_.notify_one();
+        spaceCv_.notify_all();
+    }
+}
+
+void ParallelEventProcessor::RethrowIfFailed() {
+    std::exception_ptr failure;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failure = failure_;
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
@@ -1,8 +1,13 @@
 #include "reco/common/RecoManager.hh"
 
+#include <algorithm>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include <stdexcept>
 #include <TClass.h>
+#include <TROOT.h>
 
 using namespace reco;
 
@@ -17,6 +22,18 @@ void RecoManager::Configure(std::shared_ptr<const ConfigHolder> configHolder, co
         throw std::runtime_error("RecoManager: Missing or invalid 'RecoPath' config");
     }
 
+    if (config.contains("RecoManager")) {
+        nThreads_ = config["RecoManager"].value("nThreads", 1);
+        eventQueueDepth_ = config["RecoManager"].value("eventQueueDepth", 2 * nThreads_);
+        stageThreads_ = config["RecoManager"].value("stageThreads", 1);
+    }
+    if (nThreads_ < 1) {
+        throw std::runtime_error("RecoManager: 'nThreads' must be at least 1");
+    }
+    if (stageThreads_ < 1) {
+        throw std::runtime_error("RecoManager: 'stageThreads' must be at least 1");
+    }
+
     std::cout << "-> reco::RecoManager: Configuring with " << config["RecoPath"].size() << " stages.\n";    
     for (const auto& label : config["RecoPath"]) {
         auto it = std::find_if(config["RecoStages"].begin(), config["RecoStages"].end(),
@@ -47,6 +64,13 @@ void RecoManager::Configure(std::shared_ptr<const ConfigHolder> configHolder, co
 
             stage->SetConfigHolder(configHolder);
             stage->SetRecoLabel(recoLabel);
+            stage->SetupProfiling(serviceManager);
+            if (stageConfig.value("inplace", false)) {
+                if (!stage->SupportsInplace()) {
+                    throw std::runtime_error("RecoManager: RecoStage '" + recoLabel + "' cannot run in place");
+                }
+                stage->SetInplace(true);
+            }
             stage->Configure(stageConfig, serviceManager, eventStore);
             stages_.emplace_back(stage);
 
@@ -56,11 +80,129 @@ void RecoManager::Configure(std::shared_ptr<const ConfigHolder> configHolder, co
             std::cerr << "Stage not found for label: " << label << "\n";
         }
     }
+
+    if (nThreads_ > 1) {
+        std::cout << "-> reco::RecoManager: Events will be processed on " << nThreads_ << " threads.\n";
+    }
+
+    BuildStageGraph();
+    if (stageThreads_ > 1) {
+        ROOT::EnableThreadSafety();
+        stagePool_ = std::make_unique<ThreadPool>(stageThreads_);
+        std::cout << "-> reco::RecoManager: Independent stages will run concurrently on " << stageThreads_ << " threads.\n";
+    }
+
+    // An application that runs the stages itself (without ParallelEventProcessor::Finish) gets
+    // the EndOfJob of the stages when it writes the histograms
+    endOfJobDone_ = false;
+    eventStore.OnEndOfJob([this](EventStore& store) { EndOfJob(store); });
+}
+
+void RecoManager::BuildStageGraph() {
+    size_t n = stages_.size();
+    dependents_.assign(n, {});
+    nDependencies_.assign(n, 0);
+
+    auto overlaps = [](const std::vector<std::string>& a, const std::vector<std::string>& b) {
+        return std::any_of(a.begin(), a.end(), [&](const std::string& label) {
+            return std::find(b.begin(), b.end(), label) != b.end();
+        });
+    };
+    // A stage that declares no collections may use the EventStore in ways we cannot see
+    auto undeclared = [](const RecoStage& stage) {
+        return !stage.DeclaresCollections();
+    };
+
+    // Stage i waits for an earlier stage j if it reads what j writes, writes what j reads
+    // (in-place stages) or writes what j writes, so RecoPath order is kept wherever it matters
+    std::vector<size_t> depth(n, 1);
+    for (size_t i = 0; i < n; ++i) {
+        const RecoStage& later = *stages_[i];
+        for (size_t j = 0; j < i; ++j) {
+            const RecoStage& earlier = *stages_[j];
+            bool depends = undeclared(later) || undeclared(earlier)
+                || overlaps(earlier.GetProducedLabels(), later.GetConsumedLabels())
+                || overlaps(earlier.GetConsumedLabels(), later.GetProducedLabels())
+                || overlaps(earlier.GetProducedLabels(), later.GetProducedLabels());
+            if (depends) {
+                dependents_[j].push_back(i);
+                ++nDependencies_[i];
+                depth[i] = std::max(depth[i], depth[j] + 1);
+            }
+        }
+    }
+
+    if (n > 0) {
+        std::cout << "-> reco::RecoManager: Critical path of the stage graph: "
+                  << *std::max_element(depth.begin(), depth.end()) << " of " << n << " stages.\n";
+    }
 }
 
 void RecoManager::Run(EventStore& eventStore, const ServiceManager& serviceManager) {
+    if (stagePool_) {
+        RunGraph(eventStore, serviceManager);
+        return;
+    }
     for (const auto& stage : stages_) {
         stage->RunStage(eventStore, serviceManager);
     }
 }
 
+void RecoManager::EndOfJob(EventStore& eventStore) {
+    if (endOfJobDone_) return;
+    endOfJobDone_ = true;
+    for (const auto& stage : stages_) {
+        stage->EndOfJob(eventStore);
+    }
+}
+
+void RecoManager::RunGraph(EventStore& eventStore, const ServiceManager& serviceManager) {
+    size_t n = stages_.size();
+    std::vector<int> waiting(nDependencies_);
+    std::set<size_t> ready; // lowest index first, so a single thread runs the stages in RecoPath order
+    for (size_t i = 0; i < n; ++i) {
+        if (waiting[i] == 0) ready.insert(i);
+    }
+    size_t finished = 0;
+    std::exception_ptr failure;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    // Every pool thread takes ready stages until the event is done. If the pool is busy with another
+    // event, ParallelFor runs the bodies one after the other and the first one runs every stage.
+    stagePool_->ParallelFor(stagePool_->GetNThreads(), [&](size_t) {
+        while (true) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return !ready.empty() || finished == n || failure; });
+                if (finished == n || failure) return;
+                i = *ready.begin();
+                ready.erase(ready.begin());
+            }
+
+            try {
+                stages_[i]->RunStage(eventStore, serviceManager);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!failure) failure = std::current_exception();
+                cv.notify_all();
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++finished;
+                for (size_t d : dependents_[i]) {
+                    if (--waiting[d] == 0) ready.insert(d);
+                }
+            }
+            cv.notify_all();
+        }
+    });
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
@@ -2,7 +2,7 @@
 
 using namespace reco;
 
-void RecoStage::RunStage(EventStore& eventStore, const ServiceManager& serviceManager) {
+void RecoStage::SetupProfiling(const ServiceManager& serviceManager) {
 
     // Check if we have a TimeProfilerService configured
     if (configHolder_->GetConfig().contains("RecoManager") && configHolder_->GetConfig()["RecoManager"].contains("timeProfilerLabel")) {
@@ -10,13 +10,14 @@ void RecoStage::RunStage(EventStore& eventStore, const ServiceManager& serviceMa
         auto timeProfilerService = serviceManager.Get<reco::TimeProfilerService>(timeProfilerLabel);
         if (!timeProfilerService){
             throw std::runtime_error("RecoStage: TimeProfilerService not found: " + timeProfilerLabel);
-        } else {
-            timeProfilerService->StartTimer(this->GetRecoLabel());
-            Process(eventStore, serviceManager);
-            timeProfilerService->StopTimer(this->GetRecoLabel());
         }
-    } else {
-        // If no TimeProfilerService, just run the stage
-        Process(eventStore, serviceManager);
+        profiler_ = timeProfilerService.get();
+        timerId_ = profiler_->RegisterTimer(recoLabel_);
     }
-}
\ No newline at end of file
+}
+
+void RecoStage::RunStage(EventStore& eventStore, const ServiceManager& serviceManager) {
+    // Times locally, so several worker threads can run the same stage at once; no-op without a profiler
+    TimeProfilerService::Scope scope(profiler_, timerId_);
+    Process(eventStore, serviceManager);
+}
@@ -0,0 +1,47 @@
+#include "reco/common/SplineSegments.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace reco;
+
+SplineSegments::SplineSegments(const fitter::CubicSpline& spline, const std::vector<double>& knots)
+    : knots_(knots) {
+    if (knots_.size() < 2 || !std::is_sorted(knots_.begin(), knots_.end())) {
+        throw std::runtime_error("SplineSegments: Need at least two knots in ascending order");
+    }
+
+    segments_.reserve(knots_.size() - 1);
+    for (size_t i = 0; i + 1 < knots_.size(); ++i) {
+        segments_.push_back(Sample(spline, knots_[i], (knots_[i + 1] - knots_[i]) / 3));
+    }
+
+    // Sampled strictly outside the knot range, then expressed around the edge knots
+    double leftStep = (knots_[1] - knots_[0]) / 3;
+    double rightStep = (knots_.back() - knots_[knots_.size() - 2]) / 3;
+    left_ = Sample(spline, knots_.front() - 4 * leftStep, leftStep);
+    right_ = Sample(spline, knots_.back() + rightStep, rightStep);
+}
+
+const SplineSegments::Cubic& SplineSegments::Find(double x) const {
+    if (x < knots_.front()) return left_;
+    if (x > knots_.back()) return right_;
+    size_t i = std::upper_bound(knots_.begin(), knots_.end(), x) - knots_.begin();
+    return segments_[std::min(i, segments_.size()) - 1];
+}
+
+SplineSegments::Cubic SplineSegments::Sample(const fitter::CubicSpline& spline, double x0, double step) {
+    // Forward differences of the four samples give the cubic in s = (x - x0) / step
+    double y0 = spline(x0), y1 = spline(x0 + step), y2 = spline(x0 + 2 * step), y3 = spline(x0 + 3 * step);
+    double d1 = y1 - y0;
+    double d2 = y2 - 2 * y1 + y0;
+    double d3 = y3 - 3 * y2 + 3 * y1 - y0;
+
+    Cubic cubic;
+    cubic.x0 = x0;
+    cubic.a = y0;
+    cubic.b = (d1 - d2 / 2 + d3 / 3) / step;
+    cubic.c = (d2 / 2 - d3 / 2) / (step * step);
+    cubic.d = d3 / 6 / (step * step * step);
+    return cubic;
+}
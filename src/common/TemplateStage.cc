@@ -11,16 +11,19 @@ void TemplateStage::Configure(const nlohmann::json& config, const ServiceManager
     failOnError_ = config.value("failOnError", false);
     debug_ = config.value("debug",false);
 
+    // Resolve the collections once here rather than by name on every event
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputWaveforms_ = Produces<dataProducts::WFD5Waveform>(eventStore, outputWaveformsLabel_);
 }
 
 void TemplateStage::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "TemplateStage with name '" << GetRecoLabel() << "' is processing...\n";
     try {
          // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
+        auto waveforms = store.get(inputWaveforms_);
 
         //Make a collection new waveforms
-        auto newWaveforms = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel_);
+        auto newWaveforms = store.getOrCreate(outputWaveforms_);
 
         for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
             auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
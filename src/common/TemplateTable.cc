@@ -0,0 +1,120 @@
+#include "reco/common/TemplateTable.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace reco;
+
+TemplateTable::TemplateTable(const SplineSegments& spline, double pointsPerUnit)
+    : xMin_(spline.GetXMin()), xMax_(spline.GetXMax()), left_(spline.GetLeft()), right_(spline.GetRight()) {
+    if (!(xMax_ > xMin_) || !(pointsPerUnit > 0)) {
+        throw std::runtime_error("TemplateTable: Invalid range or oversampling");
+    }
+
+    size_t nIntervals = static_cast<size_t>(std::ceil((xMax_ - xMin_) * pointsPerUnit));
+    nIntervals = std::max<size_t>(nIntervals, 1);
+    step_ = (xMax_ - xMin_) / nIntervals;
+    invStep_ = 1.0 / step_;
+
+    // Values and slopes of the spline's cubics at the grid points
+    std::vector<double> values(nIntervals + 1), slopes(nIntervals + 1);
+    for (size_t j = 0; j <= nIntervals; ++j) {
+        double x = (j == nIntervals) ? xMax_ : xMin_ + j * step_;
+        const SplineSegments::Cubic& cubic = spline.Find(x);
+        values[j] = cubic.Value(x);
+        slopes[j] = cubic.Derivative(x);
+    }
+
+    c0_.resize(nIntervals);
+    c1_.resize(nIntervals);
+    c2_.resize(nIntervals);
+    c3_.resize(nIntervals);
+    for (size_t j = 0; j < nIntervals; ++j) {
+        double v0 = values[j], v1 = values[j + 1];
+        double d0 = slopes[j] * step_, d1 = slopes[j + 1] * step_;
+        c0_[j] = v0;
+        c1_[j] = d0;
+        c2_[j] = 3 * (v1 - v0) - 2 * d0 - d1;
+        c3_[j] = 2 * (v0 - v1) + d0 + d1;
+    }
+}
+
+double TemplateTable::Value(double x) const {
+    double value;
+    Evaluate(&x, 1, 0.0, &value, nullptr);
+    return value;
+}
+
+double TemplateTable::Derivative(double x) const {
+    double value, derivative;
+    Evaluate(&x, 1, 0.0, &value, &derivative);
+    return derivative;
+}
+
+void TemplateTable::Evaluate(const double* xs, size_t n, double t, double* values, double* derivatives) const {
+    size_t i = 0;
+#ifdef __AVX2__
+    const double* c0 = c0_.data();
+    const double* c1 = c1_.data();
+    const double* c2 = c2_.data();
+    const double* c3 = c3_.data();
+    const double nIntervals = static_cast<double>(c0_.size());
+    const double lastInterval = nIntervals - 1;
+    const double offset = t + xMin_;
+    const __m256d vOffset = _mm256_set1_pd(offset);
+    const __m256d vInvStep = _mm256_set1_pd(invStep_);
+    const __m256d vZero = _mm256_setzero_pd();
+    const __m256d vMax = _mm256_set1_pd(nIntervals);
+    const __m256d vLast = _mm256_set1_pd(lastInterval);
+    for (; i + 4 <= n; i += 4) {
+        __m256d u = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(xs + i), vOffset), vInvStep);
+        __m256d inside = _mm256_and_pd(_mm256_cmp_pd(u, vZero, _CMP_GE_OQ), _mm256_cmp_pd(u, vMax, _CMP_LE_OQ));
+        if (_mm256_movemask_pd(inside) != 0xF) {
+            // Some of the four are beyond the table: the scalar loop handles them
+            for (size_t j = i; j < i + 4; ++j) EvaluateOne(xs[j], t, values[j], derivatives ? derivatives + j : nullptr);
+            continue;
+        }
+        __m256d k = _mm256_min_pd(_mm256_floor_pd(u), vLast);
+        __m256d f = _mm256_sub_pd(u, k);
+        __m128i idx = _mm256_cvttpd_epi32(k);
+
+        __m256d a0 = _mm256_i32gather_pd(c0, idx, 8);
+        __m256d a1 = _mm256_i32gather_pd(c1, idx, 8);
+        __m256d a2 = _mm256_i32gather_pd(c2, idx, 8);
+        __m256d a3 = _mm256_i32gather_pd(c3, idx, 8);
+
+        __m256d value = _mm256_add_pd(a0, _mm256_mul_pd(f, _mm256_add_pd(a1, _mm256_mul_pd(f, _mm256_add_pd(a2, _mm256_mul_pd(f, a3))))));
+        _mm256_storeu_pd(values + i, value);
+        if (derivatives) {
+            // (a1 + 2 a2 f + 3 a3 f^2) / step
+            __m256d slope = _mm256_add_pd(a1, _mm256_mul_pd(f, _mm256_add_pd(_mm256_add_pd(a2, a2),
+                                                                _mm256_mul_pd(f, _mm256_mul_pd(_mm256_set1_pd(3.0), a3)))));
+            _mm256_storeu_pd(derivatives + i, _mm256_mul_pd(slope, vInvStep));
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        EvaluateOne(xs[i], t, values[i], derivatives ? derivatives + i : nullptr);
+    }
+}
+
+void TemplateTable::EvaluateOne(double x, double t, double& value, double* derivative) const {
+    double u = (x - (t + xMin_)) * invStep_;
+    const double nIntervals = static_cast<double>(c0_.size());
+    if (!(u >= 0) || !(u <= nIntervals)) {
+        const SplineSegments::Cubic& cubic = (u < 0) ? left_ : right_;
+        value = cubic.Value(x - t);
+        if (derivative) *derivative = cubic.Derivative(x - t);
+        return;
+    }
+    double k = std::min(std::floor(u), nIntervals - 1);
+    double f = u - k;
+    size_t j = static_cast<size_t>(k);
+    value = c0_[j] + f * (c1_[j] + f * (c2_[j] + f * c3_[j]));
+    if (derivative) *derivative = (c1_[j] + f * (2 * c2_[j] + f * 3 * c3_[j])) * invStep_;
+}
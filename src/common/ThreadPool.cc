@@ -0,0 +1,136 @@
+#include "reco/common/ThreadPool.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace reco;
+
+ThreadPool::ThreadPool(int nThreads) : nThreads_(nThreads) {
+    if (nThreads_ < 1) {
+        throw std::runtime_error("ThreadPool: nThreads must be at least 1, got " + std::to_string(nThreads_));
+    }
+    for (int i = 0; i < nThreads_; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    for (int i = 1; i < nThreads_; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workCv_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t n, const std::function<void(size_t)>& body) {
+    if (n == 0) return;
+
+    std::unique_lock<std::mutex> runLock(runMutex_, std::try_to_lock);
+    if (nThreads_ == 1 || n == 1 || !runLock.owns_lock()) {
+        for (size_t i = 0; i < n; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    body_ = &body;
+    failed_ = false;
+    failure_ = nullptr;
+    remaining_ = n;
+
+    // Contiguous chunks keep neighbouring channels on the same thread until stealing starts
+    size_t chunk = (n + nThreads_ - 1) / nThreads_;
+    for (int q = 0; q < nThreads_; ++q) {
+        std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+        for (size_t i = q * chunk; i < std::min(n, (q + 1) * chunk); ++i) {
+            queues_[q]->items.push_back(i);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++generation_;
+    }
+    workCv_.notify_all();
+
+    Drain(0);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneCv_.wait(lock, [&] { return remaining_ == 0; });
+    }
+    body_ = nullptr;
+
+    if (failure_) {
+        std::rethrow_exception(failure_);
+    }
+}
+
+void ThreadPool::WorkerLoop(int self) {
+    unsigned long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            workCv_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) return;
+            seen = generation_;
+        }
+        Drain(self);
+    }
+}
+
+void ThreadPool::Drain(int self) {
+    size_t item;
+    while (Pop(self, item)) {
+        RunItem(item);
+    }
+}
+
+bool ThreadPool::Pop(int self, size_t& item) {
+    // Own queue first (newest end), then steal the oldest item of the others
+    {
+        WorkQueue& own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.items.empty()) {
+            item = own.items.back();
+            own.items.pop_back();
+            return true;
+        }
+    }
+    for (int k = 1; k < nThreads_; ++k) {
+        WorkQueue& victim = *queues_[(self + k) % nThreads_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.front();
+            victim.items.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::RunItem(size_t item) {
+    if (!failed_) {
+        try {
+            (*body_)(item);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!failed_) {
+                failure_ = std::current_exception();
+                failed_ = true;
+            }
+        }
+    }
+
+    if (--remaining_ == 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        doneCv_.notify_all();
+    }
+}
@@ -1,10 +1,14 @@
 #include "reco/common/TimeProfilerService.hh"
 
+#include <algorithm>
+#include <cmath>
+
 using namespace reco;
 
- void TimeProfilerService::Configure(const nlohmann::json& config, EventStore& eventStore) {
+ TimeProfilerService::TimeProfilerService()
+    : timers_(std::make_unique<std::array<Timer, kMaxTimers>>()) {}
 
-    auto& jsonParserUtil = reco::JsonParserUtil::instance();
+ void TimeProfilerService::Configure(const nlohmann::json& config, EventStore& eventStore) {
 
     std::cout << "-> reco::TimeProfilerService: Configuring TimeProfilerService" << std::endl;
 
@@ -18,72 +22,140 @@ using namespace reco;
         throw std::runtime_error("TimeProfilerService: Missing or invalid 'RecoPath' config");
     }
 
-
-
-    // Initialize maps
-    for (const auto& label : fullConfig["RecoPath"]) {
-        totalDurations_[label] = 0.0;
-        nEvents_[label] = 0;
-        startTime_[label] = std::chrono::high_resolution_clock::now();
-        endTime_[label] = std::chrono::high_resolution_clock::now();
-    }
-
+    // One top-level timer per stage, in RecoPath order
     std::cout << "-> reco::TimeProfilerService: Initialized timing for ";
-    // Loop with iterators
-    for (auto it = totalDurations_.begin(); it != totalDurations_.end(); ++it) {
-        if (it != totalDurations_.begin()) {
+    for (const auto& label : fullConfig["RecoPath"]) {
+        if (nTimers_ > 0) {
             std::cout << ", ";
         }
-        std::cout << "'" << it->first << "'";
+        RegisterTimer(label.get<std::string>());
+        std::cout << "'" << label.get<std::string>() << "'";
     }
     std::cout << std::endl;
  }
 
+ TimeProfilerService::TimerId TimeProfilerService::RegisterTimer(const std::string& label, TimerId parent) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int n = nTimers_.load(std::memory_order_relaxed);
+    for (int id = 0; id < n; ++id) {
+        const Timer& timer = (*timers_)[id];
+        if (timer.parent == parent && timer.label == label) return id;
+    }
+    if (n == kMaxTimers) {
+        throw std::runtime_error("TimeProfilerService: Too many timers, cannot add '" + label + "'");
+    }
+    if (parent != kNoTimer && (parent < 0 || parent >= n)) {
+        throw std::runtime_error("TimeProfilerService: Invalid parent timer for '" + label + "'");
+    }
+    Timer& timer = (*timers_)[n];
+    timer.label = label;
+    timer.parent = parent;
+    nTimers_.store(n + 1, std::memory_order_release);
+    return n;
+ }
+
+ void TimeProfilerService::AddTiming(TimerId id, std::chrono::steady_clock::duration elapsed) {
+    if (id < 0 || id >= nTimers_.load(std::memory_order_acquire)) return;
+    uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    Timer& timer = (*timers_)[id];
+    timer.count.fetch_add(1, std::memory_order_relaxed);
+    timer.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    timer.bins[BinOf(ns)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t max = timer.maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !timer.maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {}
+ }
+
  void TimeProfilerService::StartTimer(const std::string& label) {
-    startTime_[label] = std::chrono::high_resolution_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    startTime_[label] = std::chrono::steady_clock::now();
  }
 
  void TimeProfilerService::StopTimer(const std::string& label) {
-    endTime_[label] = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = endTime_[label] - startTime_[label];
-    totalDurations_[label] += elapsed.count();
-    nEvents_[label]++;
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point start;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = startTime_.find(label);
+        if (it == startTime_.end()) {
+            throw std::runtime_error("TimeProfilerService: Timer '" + label + "' was not started");
+        }
+        start = it->second;
+    }
+    AddTiming(RegisterTimer(label), now - start);
+ }
+
+ void TimeProfilerService::AddTiming(const std::string& label, double seconds) {
+    AddTiming(RegisterTimer(label), std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+ }
+
+ // Below 8 ns one bin per nanosecond, above that kSubBins bins per power of two
+ int TimeProfilerService::BinOf(uint64_t ns) {
+    if (ns < kSubBins) return static_cast<int>(ns);
+    int exponent = 63 - __builtin_clzll(ns);
+    int sub = static_cast<int>((ns >> (exponent - 3)) & (kSubBins - 1));
+    return exponent * kSubBins + sub;
+ }
+
+ double TimeProfilerService::BinUpperEdge(int bin) {
+    int exponent = bin / kSubBins;
+    if (exponent < 3) return (bin + 1) * 1e-9;
+    int sub = bin % kSubBins;
+    return std::ldexp(static_cast<double>(kSubBins + sub + 1), exponent - 3) * 1e-9;
+ }
+
+ double TimeProfilerService::Quantile(const Timer& timer, double q) const {
+    uint64_t count = timer.count.load();
+    if (count == 0) return 0.;
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count)));
+    uint64_t seen = 0;
+    double max = timer.maxNs.load() * 1e-9;
+    for (int bin = 0; bin < kBins; ++bin) {
+        seen += timer.bins[bin].load();
+        if (seen >= target) return std::min(BinUpperEdge(bin), max);
+    }
+    return max;
+ }
+
+ void TimeProfilerService::PrintTimer(TimerId id, int depth, int width) const {
+    const Timer& timer = (*timers_)[id];
+    std::string label = std::string(2 * depth, ' ') + timer.label;
+    uint64_t count = timer.count.load();
+    if (count == 0) {
+        std::cout << "  - " << std::left << std::setw(width) << label << ": No timing data available" << std::endl;
+    } else {
+        double total = timer.totalNs.load() * 1e-9;
+        std::cout << "  - "
+                  << std::left << std::setw(width) << label
+                  << ": "
+                  << std::setprecision(3) << total << "/" << count
+                  << " = " << (total / count) << " s/call"
+                  << ", p50 " << Quantile(timer, 0.5)
+                  << ", p99 " << Quantile(timer, 0.99)
+                  << ", max " << timer.maxNs.load() * 1e-9 << " s"
+                  << std::endl;
+    }
+
+    int n = nTimers_.load();
+    for (int child = 0; child < n; ++child) {
+        if ((*timers_)[child].parent == id) PrintTimer(child, depth + 1, width);
+    }
  }
 
  void TimeProfilerService::EndOfJobPrint() const {
     std::cout << "-> reco::TimeProfilerService: Timing summary:" << std::endl;
 
     // Determine the width
+    int n = nTimers_.load();
     int width = 20;
-    for (const auto& entry : totalDurations_) {
-        const std::string& label = entry.first;
-        width = std::max(width, static_cast<int>(label.length()));
+    for (int id = 0; id < n; ++id) {
+        int depth = 0;
+        for (TimerId p = (*timers_)[id].parent; p != kNoTimer; p = (*timers_)[p].parent) ++depth;
+        width = std::max(width, static_cast<int>((*timers_)[id].label.length()) + 2 * depth);
     }
     width+=5;
 
-    // Loop over the reco stages from the config holder (to keep the order)
-    for (const auto& labelKey : configHolder_->GetConfig()["RecoPath"]) {
-        const std::string& label = labelKey.get<std::string>();
-        if (totalDurations_.find(label) == totalDurations_.end()) {
-            std::cout << "  - " << std::left << std::setw(width) << label
-                      << ": No timing data available" << std::endl;
-            continue;
-        } else {
-            const auto& entry = totalDurations_.find(label);
-            double totalDuration = entry->second;
-            int nEvents = nEvents_.at(label);
-            if (nEvents > 0) {
-                std::cout << "  - " 
-                        << std::left << std::setw(width) << label
-                        << ": "
-                        << std::setprecision(3) << totalDuration << "/" << nEvents
-                        << " = "
-                        << (totalDuration / nEvents) << " seconds/event"
-                    << std::endl;
-            } else {
-                std::cout << std::left << std::setw(width) << label << ": No events processed" << std::endl;
-            }
-
-        }
+    // Top-level timers in the order they were registered (the RecoPath first), each followed by its sub-timers
+    for (int id = 0; id < n; ++id) {
+        if ((*timers_)[id].parent == kNoTimer) PrintTimer(id, 0, width);
     }
- }
\ No newline at end of file
+ }
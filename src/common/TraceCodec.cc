@@ -0,0 +1,102 @@
+#include "reco/common/TraceCodec.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace reco;
+
+void TraceCodec::Encode(const short* samples, size_t n, std::vector<uint8_t>& out) {
+    PutVarint(static_cast<uint32_t>(n), out);
+    if (n == 0) return;
+    PutVarint(ZigZag(samples[0]), out);
+
+    uint32_t deltas[kBlockSize];
+    for (size_t start = 1; start < n; start += kBlockSize) {
+        size_t count = std::min(kBlockSize, n - start);
+
+        // Zigzag differences of the block and the bits needed for the largest
+        uint32_t bitsUsed = 0;
+        for (size_t k = 0; k < count; ++k) {
+            deltas[k] = ZigZag(static_cast<int32_t>(samples[start + k]) - samples[start + k - 1]);
+            bitsUsed |= deltas[k];
+        }
+        uint8_t width = 0;
+        while (bitsUsed >> width) ++width;
+        out.push_back(width);
+
+        uint64_t acc = 0;
+        unsigned nBits = 0;
+        for (size_t k = 0; k < count; ++k) {
+            acc |= static_cast<uint64_t>(deltas[k]) << nBits;
+            nBits += width;
+            while (nBits >= 8) {
+                out.push_back(static_cast<uint8_t>(acc));
+                acc >>= 8;
+                nBits -= 8;
+            }
+        }
+        if (nBits > 0) out.push_back(static_cast<uint8_t>(acc));
+    }
+}
+
+size_t TraceCodec::Decode(const uint8_t* data, size_t size, std::vector<short>& samples) {
+    size_t pos = 0;
+    size_t n = GetVarint(data, size, pos);
+    samples.resize(n);
+    if (n == 0) return pos;
+    samples[0] = static_cast<short>(UnZigZag(GetVarint(data, size, pos)));
+
+    uint32_t deltas[kBlockSize];
+    for (size_t start = 1; start < n; start += kBlockSize) {
+        size_t count = std::min(kBlockSize, n - start);
+        if (pos >= size) {
+            throw std::runtime_error("TraceCodec: Truncated trace");
+        }
+        unsigned width = data[pos++];
+        if (width > 32 || pos + (count * width + 7) / 8 > size) {
+            throw std::runtime_error("TraceCodec: Truncated or corrupt trace");
+        }
+
+        uint64_t acc = 0;
+        unsigned nBits = 0;
+        uint64_t mask = (uint64_t(1) << width) - 1;
+        for (size_t k = 0; k < count; ++k) {
+            while (nBits < width) {
+                acc |= static_cast<uint64_t>(data[pos++]) << nBits;
+                nBits += 8;
+            }
+            deltas[k] = static_cast<uint32_t>(acc & mask);
+            acc >>= width;
+            nBits -= width;
+        }
+
+        // Running sum of the differences
+        int32_t previous = samples[start - 1];
+        for (size_t k = 0; k < count; ++k) {
+            previous += UnZigZag(deltas[k]);
+            samples[start + k] = static_cast<short>(previous);
+        }
+    }
+    return pos;
+}
+
+void TraceCodec::PutVarint(uint32_t value, std::vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint32_t TraceCodec::GetVarint(const uint8_t* data, size_t size, size_t& pos) {
+    uint32_t value = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (pos >= size) {
+            throw std::runtime_error("TraceCodec: Truncated trace");
+        }
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("TraceCodec: Corrupt length");
+}
@@ -9,6 +9,9 @@ void CaloClusterFinder::Configure(const nlohmann::json& config, const ServiceMan
     inputRecoLabel_ = config.value("inputRecoLabel", "");
     inputFitResultsLabel_ = config.value("inputFitResultsLabel", "");
     outputCaloClusterLabel_ = config.value("outputCaloClusterLabel", "");
+
+    // Process is not implemented yet and uses no collections; declare them with Consumes/Produces once it does
+    DeclareNoCollections();
 }
 
 void CaloClusterFinder::Process(EventStore& store, const ServiceManager& serviceManager) const {
@@ -0,0 +1,43 @@
+#include "reco/wfd5/ChannelIndex.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace reco;
+
+ChannelIndex::ChannelIndex(std::vector<dataProducts::ChannelID> channels)
+    : channels_(std::move(channels)) {
+    std::sort(channels_.begin(), channels_.end());
+    channels_.erase(std::unique(channels_.begin(), channels_.end()), channels_.end());
+    if (channels_.empty()) return;
+
+    int maxCrate = std::get<0>(channels_.front()), maxAmc = std::get<1>(channels_.front()), maxChannel = std::get<2>(channels_.front());
+    minCrate_ = maxCrate;
+    minAmc_ = maxAmc;
+    minChannel_ = maxChannel;
+    for (const auto& [crate, amc, channel] : channels_) {
+        minCrate_ = std::min(minCrate_, crate);
+        maxCrate = std::max(maxCrate, crate);
+        minAmc_ = std::min(minAmc_, amc);
+        maxAmc = std::max(maxAmc, amc);
+        minChannel_ = std::min(minChannel_, channel);
+        maxChannel = std::max(maxChannel, channel);
+    }
+    nCrates_ = maxCrate - minCrate_ + 1;
+    nAmcs_ = maxAmc - minAmc_ + 1;
+    nChannels_ = maxChannel - minChannel_ + 1;
+
+    // Crate, AMC and channel numbers are small, so the table stays small; refuse anything absurd
+    const size_t kMaxTableSize = 1 << 24;
+    if (size_t(nCrates_) * nAmcs_ * nChannels_ > kMaxTableSize) {
+        throw std::runtime_error("ChannelIndex: channel numbers span too wide a range (" + std::to_string(nCrates_) + " crates x " +
+                                 std::to_string(nAmcs_) + " AMCs x " + std::to_string(nChannels_) + " channels)");
+    }
+
+    lookup_.assign(size_t(nCrates_) * nAmcs_ * nChannels_, kNone);
+    for (size_t i = 0; i < channels_.size(); ++i) {
+        const auto& [crate, amc, channel] = channels_[i];
+        lookup_[((crate - minCrate_) * nAmcs_ + (amc - minAmc_)) * nChannels_ + (channel - minChannel_)] = i;
+    }
+}
@@ -69,6 +69,22 @@ using namespace reco;
             
             channelConfigMap_[std::make_tuple(crateNum, amcSlotNum, channelNum)] = ChannelConfig(entry);
         }
+        // Number the channels once, so the stages can keep their per-channel constants in flat arrays
+        std::vector<dataProducts::ChannelID> channels;
+        for (const auto& [key, value] : channelConfigMap_) channels.push_back(key);
+        channelIndex_ = std::make_shared<const ChannelIndex>(channels);
+        channelConfigs_.clear();
+        for (const auto& id : channelIndex_->GetChannels()) channelConfigs_.push_back(channelConfigMap_.at(id));
+
+        // Intern the detector names, so the stages compare ids instead of strings
+        detectorSystemIds_.clear();
+        subdetectorIds_.clear();
+        for (const auto& channelConfig : channelConfigs_) {
+            detectorSystemIds_.push_back(names_.Intern(channelConfig.GetDetectorSystem()));
+            subdetectorIds_.push_back(names_.Intern(channelConfig.GetSubdetector()));
+        }
+        unmappedId_ = names_.Intern("Other");
+
         std::cout << "-> reco::ChannelMapService: Successfully loaded channel map with "
                     << channelConfigMap_.size() << " entries." << std::endl;
         // Print the loaded channel map for debugging
@@ -1,4 +1,6 @@
 #include "reco/wfd5/DetectorGrouper.hh"
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 
 using namespace reco;
@@ -9,94 +11,70 @@ void DetectorGrouper::Configure(const nlohmann::json& config, const ServiceManag
     inputWaveformsLabel_ = config.value("inputWaveformsLabel", "WFD5WaveformCollection");
     outputWaveformsBaseLabel_ = config.value("outputWaveformsBaseLabel", "WFD5WaveformCollection");
     channelMapServiceLabel_ = config.value("channelMapServiceLabel", "channelMap");
+
+    auto channelMapService = serviceManager.Get<reco::ChannelMapService>(channelMapServiceLabel_);
+    if (!channelMapService) {
+        throw std::runtime_error("ChannelMapService not found: " + channelMapServiceLabel_);
+    }
+
+    // One output collection per detector system in the channel map, plus "Other",
+    // and the route of every mapped channel to its collection
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputWaveforms_.clear();
+    routes_.clear();
+    const NameTable& names = channelMapService->GetNames();
+    std::vector<size_t> outputIndex(names.size(), SIZE_MAX); // by detector system id
+    auto output = [&](NameTable::Id detectorSystem) {
+        if (outputIndex[detectorSystem] == SIZE_MAX) {
+            outputWaveforms_.push_back(Produces<dataProducts::WFD5Waveform>(eventStore, OutputLabel(names.GetName(detectorSystem))));
+            outputIndex[detectorSystem] = outputWaveforms_.size() - 1;
+        }
+        return outputIndex[detectorSystem];
+    };
+
+    channelIndex_ = channelMapService->GetChannelIndex();
+    for (size_t c = 0; c < channelIndex_->size(); ++c) {
+        const ChannelConfig& channelConfig = channelMapService->GetChannelConfig(c);
+        NameTable::Id detectorSystem = channelMapService->GetDetectorSystemId(c);
+        routes_.push_back({output(detectorSystem),
+                           {&names, detectorSystem, channelMapService->GetSubdetectorId(c), channelConfig.GetX(), channelConfig.GetY()}});
+    }
+    NameTable::Id other = channelMapService->GetUnmappedId();
+    otherRoute_ = {output(other), {&names, other, other, 0.0, 0.0}};
+}
+
+std::string DetectorGrouper::OutputLabel(const std::string& detectorSystem) const {
+    std::string cleanDetectorName = detectorSystem;
+    cleanDetectorName.erase(
+        std::remove_if(cleanDetectorName.begin(), cleanDetectorName.end(), ::isspace),
+        cleanDetectorName.end()
+    );
+    return outputWaveformsBaseLabel_ + cleanDetectorName;
 }
 
 void DetectorGrouper::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "DetectorGrouper with name '" << GetLabel() << "' is processing...\n";
     try {
         // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
-
-        //Get the channel map service
-        auto channelMapService = serviceManager.Get<reco::ChannelMapService>(channelMapServiceLabel_);
-        
-        if (!channelMapService) {
-            throw std::runtime_error("ChannelMapService not found: " + channelMapServiceLabel_);
+        const auto& waveforms = WaveformBatch::Get(store, inputWaveforms_);
+
+        // Tag every waveform with its placement (one copy of the metadata columns, no traces),
+        // and sort the rows by output collection
+        WaveformBatch placed;
+        placed.ShareFrom(waveforms);
+        std::vector<std::vector<size_t>> rows(outputWaveforms_.size());
+        for (size_t i = 0; i < placed.size(); ++i) {
+            int channel = channelIndex_->Find(placed.GetID(i));
+            const Route& route = channel == ChannelIndex::kNone ? otherRoute_ : routes_[channel];
+            placed.SetPlacement(i, &route.placement);
+            rows[route.output].push_back(i);
         }
 
-        // Make map for all the individual detector waveform collections
-        std::map<std::string,TClonesArray*> detectorWaveformsMap;
-
-        // Loop over the waveforms
-        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
-            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
-
-            // Create the key
-            auto key = std::make_tuple(waveform->crateNum, waveform->amcNum, waveform->channelTag);
-
-            // std::cout << "Processing waveform with key: (" 
-            //           << std::get<0>(key) << ", " 
-            //           << std::get<1>(key) << ", " 
-            //           << std::get<2>(key) << ")\n";
-            
-            //Get the channel map from the service
-            const auto& channelConfigMap = channelMapService->GetChannelMap();
-            
-            // Check that the key is in the channel map
-            if (channelConfigMap.find(key) != channelConfigMap.end()) {
-
-                // Get the detector name
-                std::string detectorSystem = channelConfigMap.at(key).GetDetectorSystem();
-                std::string subdetector = channelConfigMap.at(key).GetSubdetector();
-
-                // Make the output name
-                std::string cleanDetectorName = detectorSystem;
-                cleanDetectorName.erase(
-                    std::remove_if(cleanDetectorName.begin(), cleanDetectorName.end(), ::isspace),
-                    cleanDetectorName.end()
-                );
-                std::string outputWaveformsLabel = outputWaveformsBaseLabel_ + cleanDetectorName;
-
-                // Have we retrieved this collection yet?
-                if (detectorWaveformsMap.find(detectorSystem) == detectorWaveformsMap.end()) {
-                    // Fill the map with the TClonesArray (get or create)
-                    detectorWaveformsMap[detectorSystem] = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel);
-                }
-
-                // Make the new waveform
-                int idx = detectorWaveformsMap[detectorSystem]->GetEntriesFast();
-                auto* newWaveform = new ((*detectorWaveformsMap[detectorSystem])[idx]) dataProducts::WFD5Waveform(waveform);
-                detectorWaveformsMap[detectorSystem]->Expand(idx + 1);
-                newWaveform->SetDetectorSystem(detectorSystem);
-                newWaveform->SetSubdetector(subdetector);
-
-                newWaveform->x = channelConfigMap.at(key).GetX();
-                newWaveform->y = channelConfigMap.at(key).GetY();
-
-                // std::cout << "Waveform (crate " << thisWaveform->crateNum 
-                //           << ", amc " << thisWaveform->amcNum 
-                //           << ", channel " << thisWaveform->channelTag 
-                //           << ") mapped to detector system: " << detectorSystem 
-                //           << ", subdetector: " << subdetector << std::endl;
-
-            } else {
-                // Not in channel map, so categorize as "Other"
-                std::string outputWaveformsLabel = outputWaveformsBaseLabel_ + "Other";
-                if (detectorWaveformsMap.find("Other") == detectorWaveformsMap.end()) {
-                    // Fill the map with the TClonesArray (get or create)
-                    detectorWaveformsMap["Other"] = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel);
-                }
-                int idx = detectorWaveformsMap["Other"]->GetEntriesFast();
-                auto* newWaveform = new ((*detectorWaveformsMap["Other"])[idx]) dataProducts::WFD5Waveform(*waveform);
-                detectorWaveformsMap["Other"]->Expand(idx + 1);
-                newWaveform->SetDetectorSystem("Other");
-                newWaveform->SetSubdetector("Other");
-
-                newWaveform->x = 0.0;
-                newWaveform->y = 0.0;
-            }
+        // Each detector system gets a batch of its rows, sharing the input's traces
+        for (size_t o = 0; o < outputWaveforms_.size(); ++o) {
+            WaveformBatch::Create(store, outputWaveforms_[o]).ShareRowsFrom(placed, rows[o]);
         }
     } catch (const std::exception& e) {
        throw std::runtime_error(std::string("DetectorGrouper error: ") + e.what());
     }
-}
\ No newline at end of file
+}
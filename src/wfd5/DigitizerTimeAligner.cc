@@ -20,6 +20,7 @@ void DigitizerTimeAligner::Configure(const nlohmann::json& config, const Service
         throw std::runtime_error("ChannelMapService not found: " + channelMapServiceLabel_);
     }
     if (debug_) std::cout << "Setting up known time offset map:" << std::endl;
+    std::map<dataProducts::ChannelID, double> knownTimeOffsets;
     for (auto& map_entry:channelMapService->GetChannelMap())
     {
         if (debug_) std::cout << "   -> found time offset " << map_entry.second.GetTimeOffset() << " for channel ("
@@ -27,8 +28,16 @@ void DigitizerTimeAligner::Configure(const nlohmann::json& config, const Service
             << std::get<1>(map_entry.first) << " / "
             << std::get<2>(map_entry.first) << ")"
             << std::endl;
-        knownTimeOffsetMap_[map_entry.first] = map_entry.second.GetTimeOffset();
+        knownTimeOffsets[map_entry.first] = map_entry.second.GetTimeOffset();
     }
+    knownTimeOffsets_ = ChannelTable<double>(channelMapService->GetChannelIndex(), knownTimeOffsets);
+
+    if (inplace_) {
+        eventStore.alias(this->GetRecoLabel(), outputWaveformsLabel_, inputRecoLabel_, inputWaveformsLabel_);
+    }
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputWaveforms_ = Produces<dataProducts::WFD5Waveform>(eventStore, outputWaveformsLabel_);
+    inputT0_ = Consumes<dataProducts::TimeSeed>(eventStore, inputT0Reco_, inputT0Label_);
 
 
 
@@ -37,9 +46,7 @@ void DigitizerTimeAligner::Configure(const nlohmann::json& config, const Service
 void DigitizerTimeAligner::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "DigitizerTimeAligner with name '" << GetLabel() << "' is processing...\n";
     try {
-         // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
-        auto seeds = store.get<const dataProducts::TimeSeed>(inputT0Reco_, inputT0Label_);
+        auto seeds = store.get(inputT0_);
 
         bool foundSeed = false;
         dataProducts::TimeSeed* seed = static_cast<dataProducts::TimeSeed*>(seeds->ConstructedAt(0));
@@ -59,31 +66,24 @@ void DigitizerTimeAligner::Process(EventStore& store, const ServiceManager& serv
         }
 
 
-        //Make a collection new waveforms
-        auto newWaveforms = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel_);
-
-        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
-            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
-            if (!waveform) {
-                throw std::runtime_error("Failed to retrieve waveform at index " + std::to_string(i));
-            }
-            //Make the new waveform
-            dataProducts::WFD5Waveform* newWaveform = new ((*newWaveforms)[i]) dataProducts::WFD5Waveform(waveform);
-            newWaveforms->Expand(i + 1);
+        //Make a batch of new waveforms sharing the input's traces
+        auto& newWaveforms = WaveformBatch::Derive(store, inputWaveforms_, outputWaveforms_);
 
-            ApplyTimeAligner(newWaveform, seed, seed_wf, foundSeed);
+        for (size_t i = 0; i < newWaveforms.size(); ++i) {
+            ApplyTimeAligner(newWaveforms, i, seed, seed_wf, foundSeed);
         }
     } catch (const std::exception& e) {
        throw std::runtime_error(std::string("DigitizerTimeAligner error: ") + e.what());
     }
 }
 
-void DigitizerTimeAligner::ApplyTimeAligner(dataProducts::WFD5Waveform* wf, dataProducts::TimeSeed *seed, dataProducts::WFD5Waveform* seed_wf, bool foundSeed) const {
-    if (debug_) std::cout << "Applying time alignment to waveform " << wf << std::endl;
+void DigitizerTimeAligner::ApplyTimeAligner(WaveformBatch& waveforms, size_t i, dataProducts::TimeSeed *seed, dataProducts::WFD5Waveform* seed_wf, bool foundSeed) const {
+    const dataProducts::WFD5Waveform* wf = &waveforms.Source(i);
+    if (debug_) std::cout << "Applying time alignment to waveform " << i << std::endl;
     double known_offset = 0.0;
-    if (knownTimeOffsetMap_.count(wf->GetID()))
+    if (const double* offset = knownTimeOffsets_.Find(wf->GetID()))
     {
-        known_offset = knownTimeOffsetMap_.at(wf->GetID());
+        known_offset = *offset;
     }
     if (foundSeed)
     {
@@ -91,17 +91,17 @@ void DigitizerTimeAligner::ApplyTimeAligner(dataProducts::WFD5Waveform* wf, data
         if (debug_) std::cout << "   -> known offset for this channel: " << known_offset << std::endl;
         // get clock counter difference between this waveform and the t0 reference waveform
         // auto seed_cc = seed_wf->clockCounter;
-        wf->digitizationShift = int(seed_wf->clockCounter) - int(wf->clockCounter);
+        int digitizationShift = int(seed_wf->clockCounter) - int(wf->clockCounter);
         if (debug_) std::cout   << "    -> Clock counter shift: " << seed_wf->clockCounter 
-                                << " - " << wf->clockCounter << " = " << wf->digitizationShift 
+                                << " - " << wf->clockCounter << " = " << digitizationShift 
                                 << std::endl;
-        wf->SetTimeOffset(seed->GetTimeSeed() + known_offset);
+        waveforms.SetTimeAlignment(i, digitizationShift, seed->GetTimeSeed() + known_offset);
         // 
     }
     else
     {   
         if (debug_) std::cout << "   -> WARNING: No seed found... Only setting the known offset." << std::endl;
-        wf->SetTimeOffset(known_offset);
+        waveforms.SetTimeAlignment(i, wf->digitizationShift, known_offset);
     }
 
     // TODO: add application of custom cable length offsets
@@ -14,8 +14,10 @@ void EmptyChannelPruner::Configure(const nlohmann::json& config, const ServiceMa
     debug_ = config.value("debug",false);
     minAmplitude_ = config.value("minAmplitude",25.0);
 
-    
-    
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputWaveforms_ = Produces<dataProducts::WFD5Waveform>(eventStore, outputWaveformsLabel_);
+
+    std::map<dataProducts::ChannelID, int> minAmplitudes;
     if (config.contains("file_name"))
     {
         std::string file_name = config.value("file_name", "minimum_amplitudes.json");  
@@ -26,7 +28,7 @@ void EmptyChannelPruner::Configure(const nlohmann::json& config, const ServiceMa
         for (const auto& configi : minAmpChannelConfig_["minimumAmplitudes"]) 
         {
             std::vector<int> id = configi["channel"];
-            minAmplMap_[std::make_tuple(id[0], id[1], id[2])] = configi["minimumAmplitude"];
+            minAmplitudes[std::make_tuple(id[0], id[1], id[2])] = configi["minimumAmplitude"];
             if (debug_) std::cout << "Loading configuration for custom min-amplitude in channel ("
                 << id[0]      << " / "
                 << id[1]        << " / "
@@ -46,34 +48,40 @@ void EmptyChannelPruner::Configure(const nlohmann::json& config, const ServiceMa
                 << id[2]    << ")" 
                 << std::endl;
             dataProducts::ChannelID this_id = std::make_tuple(id[0], id[1], id[2]);
-            minAmplMap_[id] = -1;
+            minAmplitudes[this_id] = -1;
 
         }
 
     }
+    minAmplitudes_ = ChannelTable<int>(minAmplitudes);
 }
 
 void EmptyChannelPruner::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "EmptyChannelPruner with name '" << GetRecoLabel() << "' is processing...\n";
     try {
          // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
+        const auto& waveforms = WaveformBatch::Get(store, inputWaveforms_);
 
-        //Make a collection new waveforms
-        auto newWaveforms = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel_);
+        //Make a batch of the kept waveforms
+        auto& newWaveforms = WaveformBatch::Create(store, outputWaveforms_);
+        std::vector<size_t> keptRows;
 
         double thisMinAmplitude = 1e10;
         dataProducts::ChannelID this_id;
 
-        int counter = 0;
-        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
-            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
-            if (!waveform) {
-                throw std::runtime_error("Failed to retrieve waveform at index " + std::to_string(i));
+        // PeakToPeak needs a WFD5Waveform holding the current trace
+        dataProducts::WFD5Waveform scratch;
+
+        for (size_t i = 0; i < waveforms.size(); ++i) {
+            const dataProducts::WFD5Waveform* waveform = &waveforms.Source(i);
+            if (waveforms.TracesModified()) {
+                waveforms.LoadRow(i, scratch);
+                waveform = &scratch;
             }
 
             this_id = waveform->GetID();
-            thisMinAmplitude = minAmplMap_.count(this_id) ? minAmplMap_.at(this_id) : minAmplitude_;
+            const int* channelMinAmplitude = minAmplitudes_.Find(this_id);
+            thisMinAmplitude = channelMinAmplitude ? *channelMinAmplitude : minAmplitude_;
             if (debug_) 
             {
                 std::cout << "Evaluating channel ("
@@ -89,11 +97,8 @@ void EmptyChannelPruner::Process(EventStore& store, const ServiceManager& servic
 
             if (waveform->PeakToPeak() >= thisMinAmplitude)
             {
-                //Make the new waveform
                 if (debug_) std::cout << "    -> Keeping channel!" << std::endl;
-                dataProducts::WFD5Waveform* newWaveform = new ((*newWaveforms)[counter]) dataProducts::WFD5Waveform(waveform);
-                newWaveforms->Expand(counter + 1);
-                counter++;
+                keptRows.push_back(i);
             }
             else if (debug_)
             {
@@ -105,8 +110,10 @@ void EmptyChannelPruner::Process(EventStore& store, const ServiceManager& servic
             }
         }
         
-        if(debug_) std::cout << "Pruned waveforms from " << waveforms->GetEntriesFast() 
-            << " -> " << newWaveforms->GetEntriesFast() 
+        newWaveforms.ShareRowsFrom(waveforms, keptRows);
+
+        if(debug_) std::cout << "Pruned waveforms from " << waveforms.size()
+            << " -> " << newWaveforms.size()
             << std::endl;
 
     } catch (const std::exception& e) {
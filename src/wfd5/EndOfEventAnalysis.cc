@@ -7,6 +7,7 @@ void EndOfEventAnalysis::Configure(const nlohmann::json& config, const ServiceMa
 
     lysoRecoLabel_ = config.value("lysoRecoLabel", "");
     lysoWaveformsLabel_ = config.value("lysoWaveformsLabel", "");
+    lysoWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, lysoRecoLabel_, lysoWaveformsLabel_);
 
     // Make a histogram or two or more!
     eventStore.putHistogram("h_lyso_pedestals", std::make_shared<TH1D>("h_lyso_pedestals", "Pedestals", 2000, -2000, 0));
@@ -16,7 +17,7 @@ void EndOfEventAnalysis::Process(EventStore& store, const ServiceManager& servic
     // std::cout << "EndOfEventAnalysis with name '" << GetRecoLabel() << "' is processing...\n";
     try {
          // Get the input waveforms
-        auto lyso_waveforms = store.get<const dataProducts::WFD5Waveform>(lysoRecoLabel_, lysoWaveformsLabel_);
+        auto lyso_waveforms = store.get(lysoWaveforms_);
 
         for (int i = 0; i < lyso_waveforms->GetEntriesFast(); ++i) {
             auto* waveform = static_cast<dataProducts::WFD5Waveform*>(lyso_waveforms->ConstructedAt(i));
@@ -16,6 +16,14 @@ void EnergyCalibration::Configure(const nlohmann::json& config, const ServiceMan
     debug_ = config.value("debug",false);    
     integrals_ = config.value("integrals",false);
 
+    if (integrals_) {
+        inputIntegrals_ = Consumes<dataProducts::WaveformIntegral>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+        outputIntegrals_ = Produces<dataProducts::WaveformIntegral>(eventStore, outputWaveformsLabel_);
+    } else {
+        inputFits_ = Consumes<dataProducts::WaveformFit>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+        outputFits_ = Produces<dataProducts::WaveformFit>(eventStore, outputWaveformsLabel_);
+    }
+
     // Set up the parser
     auto& jsonParserUtil = reco::JsonParserUtil::instance();
 
@@ -33,9 +41,10 @@ void EnergyCalibration::Configure(const nlohmann::json& config, const ServiceMan
         }
     }
 
+    std::map<dataProducts::ChannelID, double> calibrations;
     for (const auto& configi : energyCalibConfig["calibration"]) 
     {
-        calibrationMap_[std::make_tuple(configi["crateNum"], configi["amcSlotNum"], configi["channelNum"])] = configi["calib"];
+        calibrations[std::make_tuple(configi["crateNum"], configi["amcSlotNum"], configi["channelNum"])] = configi["calib"];
         // if (debug_) 
         std::cout << "Loading configuration for energy calibration in channel ("
             << configi["crateNum"]      << " / "
@@ -44,6 +53,7 @@ void EnergyCalibration::Configure(const nlohmann::json& config, const ServiceMan
             << configi["calib"]
             << std::endl;
     }
+    calibrations_ = ChannelTable<double>(calibrations);
 }
 
 void EnergyCalibration::Process(EventStore& store, const ServiceManager& serviceManager) const {
@@ -54,13 +64,14 @@ void EnergyCalibration::Process(EventStore& store, const ServiceManager& service
         double scale = 1.0;
         if(integrals_)
         {
-            input = store.get<const dataProducts::WaveformIntegral>(inputRecoLabel_, inputWaveformsLabel_);
-            auto output = store.getOrCreate<dataProducts::WaveformIntegral>(this->GetRecoLabel(), outputWaveformsLabel_);
+            input = store.get(inputIntegrals_);
+            auto output = store.getOrCreate(outputIntegrals_);
             for (int i = 0; i < input->GetEntriesFast(); i++)
             {
                 auto inputObject = (dataProducts::WaveformIntegral*) input->At(i);
                 auto outputObject = new ((*output)[i]) dataProducts::WaveformIntegral(inputObject);
-                if (!calibrationMap_.count(inputObject->GetID()))
+                const double* calibration = calibrations_.Find(inputObject->GetID());
+                if (!calibration)
                 {
                     if(debug_) std::cout << "Warning: no calibration constant found for channel ("
                         << inputObject->crateNum << " / "
@@ -72,7 +83,7 @@ void EnergyCalibration::Process(EventStore& store, const ServiceManager& service
                 }
                 else
                 {
-                    scale = calibrationMap_.at(inputObject->GetID());
+                    scale = *calibration;
                     outputObject->CalibrateEnergies(scale);
                 }
                 output->Expand(i + 1);
@@ -80,13 +91,14 @@ void EnergyCalibration::Process(EventStore& store, const ServiceManager& service
         }
         else 
         {
-            input = store.get<const dataProducts::WaveformFit>(inputRecoLabel_, inputWaveformsLabel_);
-            auto output = store.getOrCreate<dataProducts::WaveformFit>(this->GetRecoLabel(), outputWaveformsLabel_);
+            input = store.get(inputFits_);
+            auto output = store.getOrCreate(outputFits_);
             for (int i = 0; i < input->GetEntriesFast(); i++)
             {
                 auto inputObject = (dataProducts::WaveformFit*) input->At(i);
                 auto outputObject = new ((*output)[i]) dataProducts::WaveformFit(inputObject);
-                if (!calibrationMap_.count(inputObject->GetID()))
+                const double* calibration = calibrations_.Find(inputObject->GetID());
+                if (!calibration)
                 {
                     if(debug_) std::cout << "Warning: no calibration constant found for channel ("
                         << inputObject->crateNum << " / "
@@ -98,7 +110,7 @@ void EnergyCalibration::Process(EventStore& store, const ServiceManager& service
                 }
                 else
                 {
-                    scale = calibrationMap_.at(inputObject->GetID());
+                    scale = *calibration;
                     outputObject->CalibrateEnergies(scale);
                 }
                 output->Expand(i + 1);   
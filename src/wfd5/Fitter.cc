@@ -1,6 +1,11 @@
 #include "reco/wfd5/Fitter.hh"
 #include "reco/wfd5/TemplateFitterService.hh"
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <TH1D.h>
+#include <TH2D.h>
+#include <TTree.h>
 
 using namespace reco;
 
@@ -17,6 +22,62 @@ void Fitter::Configure(const nlohmann::json& config, const ServiceManager& servi
     seededInputReco_ = config.value("intputSeededTime", "timeSeedFinder");
     seededInputLabel_ = config.value("intputSeededTimeLabel", "seed");
 
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    if (seeded_) {
+        seededInput_ = Consumes<dataProducts::TimeSeed>(eventStore, seededInputReco_, seededInputLabel_);
+    }
+    outputFitResults_ = Produces<dataProducts::WaveformFit>(eventStore, outputFitResultLabel_);
+
+    setupTimer_ = RegisterSubTimer("setup");
+    minimizationTimer_ = RegisterSubTimer("minimization");
+
+    // Where the fit time goes, by channel
+    fitCost_ = config.value("fitCostHistograms", false);
+    maxFitTime_ = config.value("maxFitTime", 10000.);
+    if (fitCost_) {
+        auto templateFitter = serviceManager.Get<TemplateFitterService>(templateFitterLabel_);
+        auto channels = templateFitter->GetValidChannels();
+        int nChannels = std::max<int>(1, channels.size());
+        auto byChannel = [&](const std::string& quantity, const std::string& title, int nBinsY, double maxY) {
+            std::shared_ptr<TH1> hist;
+            if (nBinsY > 0) {
+                hist = std::make_shared<TH2D>(HistogramName(quantity).c_str(), title.c_str(), nChannels, 0, nChannels, nBinsY, 0, maxY);
+            } else {
+                hist = std::make_shared<TH1D>(HistogramName(quantity).c_str(), title.c_str(), nChannels, 0, nChannels);
+            }
+            hist->SetDirectory(nullptr);
+            for (size_t i = 0; i < channels.size(); ++i) {
+                const auto& id = channels[i];
+                std::string binLabel = std::to_string(std::get<0>(id)) + "/" + std::to_string(std::get<1>(id)) + "/" + std::to_string(std::get<2>(id));
+                hist->GetXaxis()->SetBinLabel(i + 1, binLabel.c_str());
+            }
+            eventStore.putHistogram(HistogramName(quantity), hist);
+        };
+        histogramChannels_ = ChannelIndex(channels);
+
+        byChannel("fitTime", "Fit time;channel;fit time [us]", 200, maxFitTime_);
+        byChannel("minimizations", "Minimizer runs per fit;channel;minimizer runs", 50, 50);
+        byChannel("timeouts", "Fits that timed out;channel;fits", 0, 0);
+        auto pulses = std::make_shared<TH2D>(HistogramName("pulsesVsFitTime").c_str(), "Fit time by number of pulses;pulses;fit time [us]",
+                                             11, -0.5, 10.5, 200, 0, maxFitTime_);
+        pulses->SetDirectory(nullptr);
+        eventStore.putHistogram(HistogramName("pulsesVsFitTime"), pulses);
+    }
+
+    int nSlowFits = config.value("slowFits", 0);
+    if (nSlowFits > 0) {
+        slowFits_ = std::make_unique<SlowFitRecorder>(nSlowFits);
+    }
+
+    nThreads_ = config.value("nThreads", 1);
+    if (nThreads_ < 1) {
+        throw std::runtime_error("Fitter: nThreads must be at least 1");
+    }
+    if (nThreads_ > 1) {
+        threadPool_ = std::make_unique<ThreadPool>(nThreads_);
+        std::cout << "-> reco::Fitter: '" << GetRecoLabel() << "' fits channels on " << nThreads_ << " threads" << std::endl;
+    }
+
 }
 
 void Fitter::Process(EventStore& store, const ServiceManager& serviceManager) const {
@@ -27,14 +88,14 @@ void Fitter::Process(EventStore& store, const ServiceManager& serviceManager) co
         auto templateFitter = serviceManager.Get<TemplateFitterService>(templateFitterLabel_);
 
          // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
+        auto waveforms = store.get(inputWaveforms_);
 
         TClonesArray* seeded_input;
         dataProducts::TimeSeed* seed;
         // double seed
         if(seeded_)
         {
-            seeded_input = store.get<const dataProducts::TimeSeed>(seededInputReco_,seededInputLabel_);
+            seeded_input = store.get(seededInput_);
             seed = static_cast<dataProducts::TimeSeed*>(seeded_input->ConstructedAt(0));
             if (!seed) {
                 throw std::runtime_error("Failed to retrieve seeded time");
@@ -43,8 +104,12 @@ void Fitter::Process(EventStore& store, const ServiceManager& serviceManager) co
         }
 
         //Make a collection new waveforms
-        auto fitResults = store.getOrCreate<dataProducts::WaveformFit>(this->GetRecoLabel(), outputFitResultLabel_);
+        auto fitResults = store.getOrCreate(outputFitResults_);
 
+        // First construct every result slot in waveform order (this also makes the TRefs,
+        // which must not be created concurrently), then fill the slots independently
+        std::vector<std::pair<dataProducts::WFD5Waveform*, dataProducts::WaveformFit*>> jobs;
+        jobs.reserve(waveforms->GetEntriesFast());
         for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
             auto* wf = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
             if (!wf) {
@@ -55,57 +120,17 @@ void Fitter::Process(EventStore& store, const ServiceManager& serviceManager) co
             dataProducts::ChannelID id = wf->GetID();
             if (templateFitter->ValidChannel(id))
             {
-                 if (fit_debug) std::cout << "Performing fit on "
-                    << std::get<0>(id) << "/" << std::get<1>(id) << "/" << std::get<2>(id) 
-                    << std::endl;
-
                 // Create a new fit result for this waveform
                 int idx = fitResults->GetEntriesFast();
                 dataProducts::WaveformFit* this_fit_result = new ((*fitResults)[idx]) dataProducts::WaveformFit(wf);
                 fitResults->Expand(idx + 1);
 
-                if (fit_debug)
-                {
-                    std::cout << "*********************************" << std::endl;
-                    std::cout << "*********************************" << std::endl;
-                    std::cout << "*********************************" << std::endl;
-                    std::cout << "*********************************" << std::endl;
-                    std::cout << "Performing fit on channel " << wf->crateNum << "/" << wf->amcNum << "/" << wf->channelTag << std::endl;
-                    std::cout << "    -> Event " << wf->eventNum << " / " << wf->waveformIndex << std::endl;
-                }
-                auto start = std::chrono::high_resolution_clock::now();
-                auto thisfitter = templateFitter->GetFitter(id);
-                // if (see)
-                thisfitter->reset();
-                if (fit_debug) thisfitter->setDebug(true);
-                thisfitter->addTrace(wf->trace, 0.0);
-                auto intermediate = std::chrono::high_resolution_clock::now();
-                // auto bestchi2 = 1;
-                
-                thisfitter->SetSeeded(seeded_,seeded_extra_leeway_);
                 if (seeded_)
                 {
-                    if (fit_debug) std::cout << "Adding a guess based on the seed amp/time of " 
-                        <<  wf->PeakToPeak() 
-                        << " / " 
-                        << seed->GetTimeSeed() 
-                        << std::endl;
-                    thisfitter->AddGuess(seed->GetTimeSeed(), wf->PeakToPeak());
                     this_fit_result->seed = seed;
                     this_fit_result->is_seeded = true;
                 }
-
-                auto bestchi2 = thisfitter->performMinimization();
-                if (bestchi2 > 0) thisfitter->setFitResult(this_fit_result);
-                auto end = std::chrono::high_resolution_clock::now();
-                std::chrono::duration<double, std::micro> elapsed = end - start;
-                std::chrono::duration<double, std::micro> elapsed2 = end - intermediate;
-                if (fit_debug) std::cout << "Function call took " << elapsed.count() << " microseconds." << std::endl;
-                if (fit_debug) std::cout << "   -> minimization " << elapsed2.count() << " microseconds." << std::endl;
-                this_fit_result->fitTime = elapsed.count();
-
-                if (fit_debug) std::cout << "Final chi2: " << bestchi2 << std::endl;
-                if (fit_debug) std::cout << "Final Nfit: " << this_fit_result->nfit << std::endl;
+                jobs.emplace_back(wf, this_fit_result);
             }
             else if (fit_debug)
             {
@@ -118,7 +143,195 @@ void Fitter::Process(EventStore& store, const ServiceManager& serviceManager) co
 
         }
 
+        std::vector<int> nMinimizations(jobs.size(), 0);
+        auto fitOne = [&](size_t j) {
+            nMinimizations[j] = FitWaveform(jobs[j].first, jobs[j].second, *templateFitter, seeded_ ? seed : nullptr);
+        };
+        if (threadPool_) {
+            threadPool_->ParallelFor(jobs.size(), fitOne);
+        } else {
+            for (size_t j = 0; j < jobs.size(); ++j) fitOne(j);
+        }
+
+        if (fitCost_) {
+            std::vector<dataProducts::WaveformFit*> results;
+            results.reserve(jobs.size());
+            for (const auto& job : jobs) results.push_back(job.second);
+            FillFitCost(store, results, nMinimizations);
+        }
+
     } catch (const std::exception& e) {
        throw std::runtime_error(std::string("Fitter error: ") + e.what());
     }
-}
\ No newline at end of file
+}
+
+int Fitter::FitWaveform(dataProducts::WFD5Waveform* wf, dataProducts::WaveformFit* this_fit_result,
+                        const TemplateFitterService& templateFitter, dataProducts::TimeSeed* seed) const {
+
+    dataProducts::ChannelID id = wf->GetID();
+    if (fit_debug) std::cout << "Performing fit on "
+        << std::get<0>(id) << "/" << std::get<1>(id) << "/" << std::get<2>(id) 
+        << std::endl;
+
+    if (fit_debug)
+    {
+        std::cout << "*********************************" << std::endl;
+        std::cout << "*********************************" << std::endl;
+        std::cout << "*********************************" << std::endl;
+        std::cout << "*********************************" << std::endl;
+        std::cout << "Performing fit on channel " << wf->crateNum << "/" << wf->amcNum << "/" << wf->channelTag << std::endl;
+        std::cout << "    -> Event " << wf->eventNum << " / " << wf->waveformIndex << std::endl;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    // borrowed for this waveform only, returned to the service's pool at the end of the function
+    auto thisfitter = templateFitter.GetFitter(id);
+    // if (see)
+    thisfitter->reset();
+    if (fit_debug) thisfitter->setDebug(true);
+    thisfitter->addTrace(wf->trace, 0.0);
+    auto intermediate = std::chrono::high_resolution_clock::now();
+    // auto bestchi2 = 1;
+    
+    thisfitter->SetSeeded(seeded_,seeded_extra_leeway_);
+    if (seeded_)
+    {
+        if (fit_debug) std::cout << "Adding a guess based on the seed amp/time of " 
+            <<  wf->PeakToPeak() 
+            << " / " 
+            << seed->GetTimeSeed() 
+            << std::endl;
+        thisfitter->AddGuess(seed->GetTimeSeed(), wf->PeakToPeak());
+    }
+
+    // What a slow fit is replayed from
+    std::vector<double> initialGuesses;
+    if (slowFits_) initialGuesses = thisfitter->GetGuesses();
+
+    auto bestchi2 = thisfitter->performMinimization();
+    if (bestchi2 > 0) thisfitter->setFitResult(this_fit_result);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::micro> elapsed = end - start;
+    std::chrono::duration<double, std::micro> elapsed2 = end - intermediate;
+    if (fit_debug) std::cout << "Function call took " << elapsed.count() << " microseconds." << std::endl;
+    if (fit_debug) std::cout << "   -> minimization " << elapsed2.count() << " microseconds." << std::endl;
+    this_fit_result->fitTime = elapsed.count();
+    if (profiler_) {
+        profiler_->AddTiming(setupTimer_, std::chrono::duration_cast<std::chrono::steady_clock::duration>(intermediate - start));
+        profiler_->AddTiming(minimizationTimer_, std::chrono::duration_cast<std::chrono::steady_clock::duration>(end - intermediate));
+    }
+
+    if (fit_debug) std::cout << "Final chi2: " << bestchi2 << std::endl;
+    if (fit_debug) std::cout << "Final Nfit: " << this_fit_result->nfit << std::endl;
+
+    // Keep what is needed to replay the fit if it is one of the slowest
+    if (slowFits_ && slowFits_->IsCandidate(this_fit_result->fitTime)) {
+        SlowFitRecorder::Entry entry;
+        entry.fitTime = this_fit_result->fitTime;
+        entry.id = id;
+        entry.eventNum = wf->eventNum;
+        entry.waveformIndex = wf->waveformIndex;
+        entry.seeded = seeded_;
+        entry.seedTime = seeded_ ? seed->GetTimeSeed() : 0;
+        entry.guesses = std::move(initialGuesses);
+        entry.fitConfig = templateFitter.GetFitConfig(id).dump();
+        entry.chi2 = bestchi2;
+        entry.nPulses = this_fit_result->times.size();
+        entry.nMinimizations = thisfitter->GetNMinimizations();
+        entry.timeout = this_fit_result->timeout;
+        entry.trace = wf->trace;
+        slowFits_->Add(std::move(entry));
+    }
+    return thisfitter->GetNMinimizations();
+}
+
+void Fitter::FillFitCost(EventStore& store, const std::vector<dataProducts::WaveformFit*>& results,
+                         const std::vector<int>& nMinimizations) const {
+    auto fitTime = store.GetHistogram(HistogramName("fitTime"));
+    auto minimizations = store.GetHistogram(HistogramName("minimizations"));
+    auto timeouts = store.GetHistogram(HistogramName("timeouts"));
+    auto pulses = store.GetHistogram(HistogramName("pulsesVsFitTime"));
+    for (size_t j = 0; j < results.size(); ++j) {
+        const auto* result = results[j];
+        int index = histogramChannels_.Find(result->GetID());
+        if (index == ChannelIndex::kNone) continue;
+        double channel = index + 0.5;
+        fitTime->Fill(channel, result->fitTime);
+        minimizations->Fill(channel, nMinimizations[j]);
+        if (result->timeout) timeouts->Fill(channel);
+        pulses->Fill(result->times.size(), result->fitTime);
+    }
+}
+
+void Fitter::EndOfJob(EventStore& eventStore) {
+    if (fitCost_) {
+        auto fitTime = std::dynamic_pointer_cast<TH2D>(eventStore.GetHistogram(HistogramName("fitTime")));
+        auto minimizations = std::dynamic_pointer_cast<TH2D>(eventStore.GetHistogram(HistogramName("minimizations")));
+        auto timeouts = eventStore.GetHistogram(HistogramName("timeouts"));
+
+        // The channels with the largest total fit time
+        struct Row { std::string channel; double fits, total, mean, minimizations, timeouts; };
+        std::vector<Row> rows;
+        for (int bin = 1; bin <= fitTime->GetNbinsX(); ++bin) {
+            double fits = 0, total = 0, runs = 0, nRuns = 0;
+            for (int y = 0; y <= fitTime->GetNbinsY() + 1; ++y) {
+                double n = fitTime->GetBinContent(bin, y);
+                fits += n;
+                total += n * fitTime->GetYaxis()->GetBinCenter(y);
+            }
+            for (int y = 1; y <= minimizations->GetNbinsY() + 1; ++y) {
+                double n = minimizations->GetBinContent(bin, y);
+                runs += n * minimizations->GetYaxis()->GetBinLowEdge(y);
+                nRuns += n;
+            }
+            if (fits == 0) continue;
+            rows.push_back({fitTime->GetXaxis()->GetBinLabel(bin), fits, total, total / fits,
+                            nRuns > 0 ? runs / nRuns : 0, timeouts->GetBinContent(bin)});
+        }
+        std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.total > b.total; });
+
+        std::cout << "-> reco::Fitter: Fit cost of '" << GetRecoLabel() << "' (channels with the largest total fit time):" << std::endl;
+        std::cout << "  " << std::left << std::setw(12) << "channel" << std::right << std::setw(10) << "fits"
+                  << std::setw(14) << "mean [us]" << std::setw(14) << "runs/fit" << std::setw(10) << "timeouts" << std::endl;
+        for (size_t i = 0; i < rows.size() && i < 20; ++i) {
+            const auto& row = rows[i];
+            std::cout << "  " << std::left << std::setw(12) << row.channel << std::right << std::setw(10) << row.fits
+                      << std::setw(14) << std::setprecision(4) << row.mean << std::setw(14) << row.minimizations
+                      << std::setw(10) << row.timeouts << std::endl;
+        }
+    }
+
+    // The slowest fits, with what is needed to replay them
+    if (slowFits_) {
+        auto slowest = slowFits_->GetSlowest();
+        std::string name = "t_" + GetRecoLabel() + "_slowFits";
+        auto tree = std::make_shared<TTree>(name.c_str(), "Slowest fits");
+        tree->SetDirectory(nullptr);
+
+        SlowFitRecorder::Entry row;
+        int crate = 0, amc = 0, channel = 0;
+        tree->Branch("crate", &crate);
+        tree->Branch("amc", &amc);
+        tree->Branch("channel", &channel);
+        tree->Branch("eventNum", &row.eventNum);
+        tree->Branch("waveformIndex", &row.waveformIndex);
+        tree->Branch("fitTime", &row.fitTime);
+        tree->Branch("seeded", &row.seeded);
+        tree->Branch("seedTime", &row.seedTime);
+        tree->Branch("guesses", &row.guesses);
+        tree->Branch("fitConfig", &row.fitConfig);
+        tree->Branch("chi2", &row.chi2);
+        tree->Branch("nPulses", &row.nPulses);
+        tree->Branch("nMinimizations", &row.nMinimizations);
+        tree->Branch("timeout", &row.timeout);
+        tree->Branch("trace", &row.trace);
+        for (auto& entry : slowest) {
+            row = std::move(entry);
+            std::tie(crate, amc, channel) = row.id;
+            tree->Fill();
+        }
+        eventStore.putObject(name, tree);
+        if (!slowest.empty()) {
+            std::cout << "-> reco::Fitter: Stored the " << slowest.size() << " slowest fits of '" << GetRecoLabel() << "' in tree '" << name << "'." << std::endl;
+        }
+    }
+}
@@ -1,4 +1,5 @@
 #include "reco/wfd5/JitterCorrector.hh"
+#include <algorithm>
 #include <iostream>
 
 using namespace reco;
@@ -25,9 +26,10 @@ void JitterCorrector::Configure(const nlohmann::json& config, const ServiceManag
         throw std::runtime_error("JitterCorrector configuration file not found for run: " + std::to_string(run) + ", subrun: " + std::to_string(subrun));
     }   
 
+    std::map<dataProducts::ChannelID, int> offsets;
     for (const auto& configi : pedestalConfig["pedestals"]) 
     {
-        offsetMap_[std::make_tuple(configi["crateNum"], configi["amcSlotNum"], configi["channelNum"])] = configi["pedestal"];
+        offsets[std::make_tuple(configi["crateNum"], configi["amcSlotNum"], configi["channelNum"])] = configi["pedestal"];
         if (debug_) std::cout << "Loading configuration for odd/even difference in channel ("
             << configi["crateNum"]      << " / "
             << configi["amcSlotNum"]        << " / "
@@ -35,54 +37,51 @@ void JitterCorrector::Configure(const nlohmann::json& config, const ServiceManag
             << configi["pedestal"]
             << std::endl;
     }
+
+    offsets_ = ChannelTable<int>(offsets);
+
+    if (inplace_) {
+        eventStore.alias(this->GetRecoLabel(), outputWaveformsLabel_, inputRecoLabel_, inputWaveformsLabel_);
+    }
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputWaveforms_ = Produces<dataProducts::WFD5Waveform>(eventStore, outputWaveformsLabel_);
 }
 
 void JitterCorrector::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "JitterCorrector with name '" << GetRecoLabel() << "' is processing...\n";
     try {
-         // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
+        //Make a batch of new waveforms from the input; the traces are copied once, on the first correction
+        auto& newWaveforms = WaveformBatch::Derive(store, inputWaveforms_, outputWaveforms_);
+        dataProducts::WFD5Waveform scratch;
 
-        //Make a collection new waveforms
-        auto newWaveforms = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel_);
-
-        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
-            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
-            if (!waveform) {
-                throw std::runtime_error("Failed to retrieve waveform at index " + std::to_string(i));
+        for (size_t i = 0; i < newWaveforms.size(); ++i) {
+            auto id = newWaveforms.GetID(i);
+            const int* offset = offsets_.Find(id);
+            if (!offset) {
+                if (failOnError_) {
+                    throw std::runtime_error("no odd/even pedestal difference found for channel "
+                        + std::to_string(std::get<0>(id)) + " / "
+                        + std::to_string(std::get<1>(id)) + " / "
+                        + std::to_string(std::get<2>(id)));
+                }
+                continue;
             }
-            //Make the new waveform
-            dataProducts::WFD5Waveform* newWaveform = new ((*newWaveforms)[i]) dataProducts::WFD5Waveform(waveform);
-            newWaveforms->Expand(i + 1);
 
-            ApplyJitterCorrection(newWaveform);
+            if (debug_) std::cout << "Correcting pedestal difference found for channel"
+                << std::get<0>(id) << " / "
+                << std::get<1>(id) << " / "
+                << std::get<2>(id) << " with "
+                << *offset
+                << std::endl;
+            // The correction itself is the data product's: run it on a copy of the row and keep its trace
+            newWaveforms.LoadRow(i, scratch);
+            scratch.JitterCorrect(*offset);
+            if (scratch.trace.size() != newWaveforms.TraceLength(i)) {
+                throw std::runtime_error("WFD5Waveform::JitterCorrect changed the trace length");
+            }
+            std::copy(scratch.trace.begin(), scratch.trace.end(), newWaveforms.MutableTrace(i));
         }
     } catch (const std::exception& e) {
        throw std::runtime_error(std::string("JitterCorrector error: ") + e.what());
     }
 }
-
-void JitterCorrector::ApplyJitterCorrection(dataProducts::WFD5Waveform* wf) const {
-    // Implement jitter correction here
-    if (offsetMap_.count(wf->GetID()))
-    {
-        if (debug_) std::cout << "Correcting pedestal difference found for channel"
-            << std::get<0>(wf->GetID()) << " / "
-            << std::get<1>(wf->GetID()) << " / "
-            << std::get<2>(wf->GetID()) << " with " 
-            << offsetMap_.at(wf->GetID())
-            << std::endl;
-        wf->JitterCorrect(
-            offsetMap_.at(wf->GetID())
-        );
-    }
-    else if (failOnError_)
-    {
-        std::cerr << "Warning: no odd/even pedestal difference found for channel"
-            << std::get<0>(wf->GetID()) << " / "
-            << std::get<1>(wf->GetID()) << " / "
-            << std::get<2>(wf->GetID()) 
-            << std::endl;
-        throw;
-    }
-}
\ No newline at end of file
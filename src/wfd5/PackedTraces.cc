@@ -0,0 +1,37 @@
+#include "reco/wfd5/PackedTraces.hh"
+
+#include <stdexcept>
+#include <string>
+
+#include "reco/common/TraceCodec.hh"
+
+using namespace reco;
+
+void PackedTraces::Clear(Option_t*) {
+    data_.clear();
+    offsets_.clear();
+}
+
+void PackedTraces::Add(const std::vector<short>& trace) {
+    if (offsets_.empty()) offsets_.push_back(0);
+    TraceCodec::Encode(trace.data(), trace.size(), data_);
+    offsets_.push_back(static_cast<uint32_t>(data_.size()));
+}
+
+void PackedTraces::Decode(size_t i, std::vector<short>& trace) const {
+    if (i >= size()) {
+        throw std::out_of_range("PackedTraces: No trace " + std::to_string(i));
+    }
+    TraceCodec::Decode(data_.data() + offsets_[i], offsets_[i + 1] - offsets_[i], trace);
+}
+
+void PackedTraces::Restore(TClonesArray& waveforms) const {
+    if (static_cast<size_t>(waveforms.GetEntriesFast()) != size()) {
+        throw std::runtime_error("PackedTraces: " + std::to_string(size()) + " traces for "
+                                 + std::to_string(waveforms.GetEntriesFast()) + " waveforms");
+    }
+    for (size_t i = 0; i < size(); ++i) {
+        auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms.At(i));
+        Decode(i, waveform->trace);
+    }
+}
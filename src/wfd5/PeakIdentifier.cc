@@ -9,6 +9,9 @@ void PeakIdentifier::Configure(const nlohmann::json& config, const ServiceManage
     inputRecoLabel_ = config.value("inputRecoLabel", "timeAligned");
     inputWaveformsLabel_ = config.value("inputWaveformsLabel", "Waveforms");
     outputPeaksLabel_ = config.value("outputPeaksLabel", "Peaks");
+
+    // Process is not implemented yet and uses no collections; declare them with Consumes/Produces once it does
+    DeclareNoCollections();
 }
 
 void PeakIdentifier::Process(EventStore& store, const ServiceManager& serviceManager) const {
@@ -22,6 +22,12 @@ void PedestalCalculator::Configure(const nlohmann::json& config, const ServiceMa
                 << "  numSamples: " << numSamples_ << "\n";
     }
 
+    if (inplace_) {
+        eventStore.alias(this->GetRecoLabel(), outputWaveformsLabel_, inputRecoLabel_, inputWaveformsLabel_);
+    }
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputWaveforms_ = Produces<dataProducts::WFD5Waveform>(eventStore, outputWaveformsLabel_);
+
     // Example of making a histogram
     eventStore.putHistogram("h_pedestals", std::make_shared<TH1D>("h_pedestals", "Pedestals", 2000, -2000, 0));
 }
@@ -29,27 +35,20 @@ void PedestalCalculator::Configure(const nlohmann::json& config, const ServiceMa
 void PedestalCalculator::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "PedestalCalculator with name '" << GetLabel() << "' is processing...\n";
     try {
-         // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
-
         // auto channelMapService = serviceManager.Get<reco::ChannelMapService>(channelMapServiceLabel_);
 
-        //Make a collection new waveforms
-        auto newWaveforms = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel_);
+        //Make a batch of new waveforms sharing the input's traces
+        auto& newWaveforms = WaveformBatch::Derive(store, inputWaveforms_, outputWaveforms_);
 
-        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
-            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
-            if (!waveform) {
-                throw std::runtime_error("Failed to retrieve waveform at index " + std::to_string(i));
-            }
-            //Make the new waveform
-            dataProducts::WFD5Waveform* newWaveform = new ((*newWaveforms)[i]) dataProducts::WFD5Waveform(waveform);
-            newWaveforms->Expand(i + 1);
+        auto hist = store.GetHistogram("h_pedestals");
+        for (size_t i = 0; i < newWaveforms.size(); ++i) {
+            double pedestal, pedestalStdev;
+            int startIndex, endIndex;
+            ComputePedestal(newWaveforms.Trace(i), newWaveforms.TraceLength(i), pedestal, pedestalStdev, startIndex, endIndex);
+            newWaveforms.SetPedestal(i, pedestal, pedestalStdev, startIndex, endIndex);
 
-             ComputePedestal(newWaveform);
-
-             // Fill the histogram
-             store.GetHistogram("h_pedestals")->Fill(newWaveform->pedestalLevel);
+            // Fill the histogram
+            hist->Fill(pedestal);
         }
     } catch (const std::exception& e) {
        throw std::runtime_error(std::string("PedestalCalculator error: ") + e.what());
@@ -57,46 +56,49 @@ void PedestalCalculator::Process(EventStore& store, const ServiceManager& servic
 }
 
 void PedestalCalculator::ComputePedestal(dataProducts::WFD5Waveform* wf) const {
-    
+
+    double pedestal, pedestalStdev;
+    int startIndex, endIndex;
+    ComputePedestal(wf->trace.data(), wf->trace.size(), pedestal, pedestalStdev, startIndex, endIndex);
+
+    // Set the waveform pedestal values
+    wf->pedestalLevel = pedestal;
+    wf->pedestalStdev = pedestalStdev;
+    wf->pedestalSamples.assign(wf->trace.begin() + startIndex, wf->trace.begin() + endIndex);
+    wf->pedestalStartSample = startIndex;
+}
+
+void PedestalCalculator::ComputePedestal(const short* trace, size_t length, double& pedestal, double& pedestalStdev,
+                                         int& startIndex, int& endIndex) const {
+
     // Initialize the pedestal
-    double pedestal = 0.0;
-    double pedestalStdev = 0.0;
+    pedestal = 0.0;
+    pedestalStdev = 0.0;
 
-    // Get the trace
-    const auto& trace = wf->trace;
+    startIndex = -1;
+    endIndex = -1;
 
-    int startIndex = -1;
-    int endIndex = -1;
-    
     if (pedestalMethod_ == "FirstN") {
         startIndex = 0;
-        endIndex = std::min(numSamples_, static_cast<int>(trace.size()));
+        endIndex = std::min(numSamples_, static_cast<int>(length));
     } else if (pedestalMethod_ == "MiddleN") {
-        startIndex = (trace.size() - numSamples_) / 2;
-        endIndex = startIndex + numSamples_ < trace.size() ? startIndex + numSamples_ : trace.size();
+        startIndex = (length - numSamples_) / 2;
+        endIndex = startIndex + numSamples_ < length ? startIndex + numSamples_ : length;
     } else if (pedestalMethod_ == "LastN") {
-        startIndex = std::max(0, static_cast<int>(trace.size()) - numSamples_);
-        endIndex = trace.size();
+        startIndex = std::max(0, static_cast<int>(length) - numSamples_);
+        endIndex = length;
     } else {
         throw std::runtime_error("Unknown pedestal method: " + pedestalMethod_);
     }
 
-    std::vector<short> pedestalSamples;
-    for (size_t i = startIndex; i < endIndex; ++i) {
-        pedestalSamples.push_back(trace[i]);
+    for (int i = startIndex; i < endIndex; ++i) {
         pedestal += trace[i];
     }
     pedestal /= (endIndex - startIndex);
 
     // Compute the standard deviation
-    for (const auto& sample : pedestalSamples) {
-        pedestalStdev += (sample - pedestal) * (sample - pedestal);
+    for (int i = startIndex; i < endIndex; ++i) {
+        pedestalStdev += (trace[i] - pedestal) * (trace[i] - pedestal);
     }
-    pedestalStdev = std::sqrt(pedestalStdev / pedestalSamples.size());
-
-    // Set the waveform pedestal values
-    wf->pedestalLevel = pedestal;
-    wf->pedestalStdev = pedestalStdev;
-    wf->pedestalSamples = pedestalSamples;
-    wf->pedestalStartSample = startIndex;
+    pedestalStdev = std::sqrt(pedestalStdev / (endIndex - startIndex));
 }
\ No newline at end of file
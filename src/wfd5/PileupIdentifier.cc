@@ -9,6 +9,9 @@ void PileupIdentifier::Configure(const nlohmann::json& config, const ServiceMana
     inputRecoLabel_ = config.value("inputRecoLabel", "peaks");
     inputPeaksLabel_ = config.value("inputPeaksLabel", "Peaks");
     outputPileupLabel_ = config.value("outputPileupLabel", "Pileup");
+
+    // Process is not implemented yet and uses no collections; declare them with Consumes/Produces once it does
+    DeclareNoCollections();
 }
 
 void PileupIdentifier::Process(EventStore& store, const ServiceManager& serviceManager) const {
@@ -16,6 +16,12 @@ void PulseIntegrator::Configure(const nlohmann::json& config, const ServiceManag
     inputSeedRecoLabel_ = config.value("inputSeedRecoLabel", "grouped");
     inputSeedLabel_ = config.value("inputSeedLabel", "WaveformsXtal");
 
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    if (seeded_) {
+        inputSeed_ = Consumes<dataProducts::TimeSeed>(eventStore, inputSeedRecoLabel_, inputSeedLabel_);
+    }
+    outputIntegrals_ = Produces<dataProducts::WaveformIntegral>(eventStore, outputIntegralsLabel_);
+
     // parse out the default integration strategy
     defaultConfig_ = {
         config.value("skipChannel", false),
@@ -31,10 +37,11 @@ void PulseIntegrator::Configure(const nlohmann::json& config, const ServiceManag
     std::string file_path = "";
     json_ = jsonParserUtil.GetPathAndParseFile(file_name_, file_path, debug_);
 
+    std::map<dataProducts::ChannelID, PulseIntegrationConfig> channelConfigs;
     for (const auto& configi : json_["integrators"]) {
         std::vector<int> jid = configi["channel"];
         dataProducts::ChannelID id = {jid[0],jid[1],jid[2]};
-        channelConfigMap_[id] = {
+        channelConfigs[id] = {
             config.value("skipChannel",     defaultConfig_.skipChannel ),
             config.value("nPresamples",     defaultConfig_.nPresamples  ),
             config.value("windowLength",    defaultConfig_.windowLength  ),
@@ -43,6 +50,7 @@ void PulseIntegrator::Configure(const nlohmann::json& config, const ServiceManag
             config.value("nSigma",    defaultConfig_.nSigma  )
         };
     }
+    channelConfigs_ = ChannelTable<PulseIntegrationConfig>(channelConfigs);
 
 
 
@@ -51,10 +59,10 @@ void PulseIntegrator::Configure(const nlohmann::json& config, const ServiceManag
 void PulseIntegrator::Process(EventStore& store, const ServiceManager& serviceManager)  const {
 
     // get the input waveforms
-    auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
+    auto waveforms = store.get(inputWaveforms_);
     
     // create the output collection
-    auto integrals = store.getOrCreate<dataProducts::WaveformIntegral>(this->GetRecoLabel(), outputIntegralsLabel_);
+    auto integrals = store.getOrCreate(outputIntegrals_);
 
     // loop through each of the waveforms
     PulseIntegrationConfig thisConfig;
@@ -63,7 +71,7 @@ void PulseIntegrator::Process(EventStore& store, const ServiceManager& serviceMa
     dataProducts::TimeSeed* seed;
     if (seeded_)
     {
-        seeds = store.get<const dataProducts::TimeSeed>(inputSeedRecoLabel_,inputSeedLabel_);
+        seeds = store.get(inputSeed_);
         seed = static_cast<dataProducts::TimeSeed*>(seeds->ConstructedAt(0));
     }
     
@@ -77,9 +85,9 @@ void PulseIntegrator::Process(EventStore& store, const ServiceManager& serviceMa
         
         
         // check if ID is in the override list, otherwise do the default processing
-        if (channelConfigMap_.count(waveform->GetID()))
+        if (const PulseIntegrationConfig* channelConfig = channelConfigs_.Find(waveform->GetID()))
         {
-            thisConfig = channelConfigMap_.at(waveform->GetID());
+            thisConfig = *channelConfig;
         }
         else
         {
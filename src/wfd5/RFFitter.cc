@@ -1,6 +1,9 @@
 
 #include "reco/wfd5/RFFitter.hh"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <numeric>
 
 using namespace reco;
 
@@ -9,21 +12,37 @@ void RFFitter::Configure(const nlohmann::json& config, const ServiceManager& ser
     inputRecoLabel_ = config.value("inputRecoLabel", "");
     inputWaveformsLabel_ = config.value("inputWaveformsLabel", "");
     outputFitResultLabel_ = config.value("outputFitResultLabel", "");
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputFitResults_ = Produces<dataProducts::RFWaveformFit>(eventStore, outputFitResultLabel_);
     fitStartTime_ = config.value("fitStartTime", 0.0);
     fitEndTime_ = config.value("fitEndTime", 100.0);
     frequency_ = config.value("frequency", -1.0); // important that this is -1.0, not 1 to get a double; -1 means "use the zero crossings to estimate the frequency"
     fixFrequency_ = config.value("fixedFrequency", false);
     fitOption_ = config.value("fitOption", "R");
+    useRange_ = fitOption_.find('R') != std::string::npos;
+    storeFitFunction_ = config.value("storeFitFunction", false);
+
+    // With a configured frequency the basis is the same for every waveform with the same window
+    bases_ = std::make_unique<BasisCache>();
+
+    // Follow the frequency from event to event instead of estimating it per waveform
+    phaseTrackerLabel_ = config.value("phaseTrackerLabel", "");
+    if (!phaseTrackerLabel_.empty()) {
+        phaseTracker_ = serviceManager.Get<RFPhaseTrackerService>(phaseTrackerLabel_);
+        if (!phaseTracker_) {
+            throw std::runtime_error("RFFitter: '" + phaseTrackerLabel_ + "' is not an RFPhaseTrackerService");
+        }
+    }
 }
 
 void RFFitter::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "RFFitter with name '" << GetRecoLabel() << "' is processing...\n";
     try {
          // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
+        auto waveforms = store.get(inputWaveforms_);
 
         //Make a collection new waveforms
-        auto fitResults = store.getOrCreate<dataProducts::RFWaveformFit>(this->GetRecoLabel(), outputFitResultLabel_);
+        auto fitResults = store.getOrCreate(outputFitResults_);
 
         for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
             auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
@@ -35,7 +54,13 @@ void RFFitter::Process(EventStore& store, const ServiceManager& serviceManager)
             fitResults->Expand(i + 1);
 
             // Do the fit
-            PerformRFFit(waveform,newFitResult);
+            if (phaseTracker_) {
+                PerformTrackedRFFit(waveform, newFitResult);
+            } else if (fixFrequency_) {
+                PerformLinearRFFit(waveform, newFitResult);
+            } else {
+                PerformRFFit(waveform, newFitResult);
+            }
 
         }
 
@@ -44,28 +69,24 @@ void RFFitter::Process(EventStore& store, const ServiceManager& serviceManager)
     }
 }
 
-void RFFitter::PerformRFFit(const dataProducts::WFD5Waveform* waveform, dataProducts::RFWaveformFit* fitResult) const {
-    // std::cout << "Performing RF fit for waveform with index: " << waveform->waveformIndex << std::endl;
-
-    // Get the trace
-    auto trace = waveform->trace;
-
-    // Make a TGraph
-    TGraph* graph = new TGraph(trace.size());
-    for (size_t i = 0; i < trace.size(); ++i) {
-        graph->SetPoint(i, i, trace[i]);
+void RFFitter::FitWindow(size_t traceSize, int& first, int& last) const {
+    first = 0;
+    last = static_cast<int>(traceSize) - 1;
+    if (useRange_) {
+        first = std::max(first, static_cast<int>(std::ceil(fitStartTime_)));
+        last = std::min(last, static_cast<int>(std::floor(fitEndTime_)));
     }
+}
 
-    // Make the fit function
-    TF1 fitFunc("fitFunc", "[1]*cos(x*[0]) + [2]*sin([0]*x) + [3]", 0, trace.size());
+void RFFitter::EstimateParameters(const std::vector<short>& trace, double& freq, double& amplitude, double& phase, double& baseline) const {
 
     // Estimate baseline as mean value
-    double baseline = std::accumulate(trace.begin(), trace.end(), 0.0) / trace.size();
+    baseline = std::accumulate(trace.begin(), trace.end(), 0.0) / trace.size();
 
     // Determine the number of (positive) zero crossings to estimate frequency and phase; also estimate the amplitude
     int zeroCrossings = 0;
     double firstPosCrossingTime = 0.0;
-    double amplitude = 0.0;
+    amplitude = 0.0;
     int spacing = 1;
     for (size_t i = spacing; i < trace.size(); ++i) {
         if ((trace[i-spacing] < baseline && trace[i] >= baseline)) {
@@ -80,16 +101,96 @@ void RFFitter::PerformRFFit(const dataProducts::WFD5Waveform* waveform, dataProd
     }
 
     // Use the provided frequency if > 0
-    double freq = frequency_;
+    freq = frequency_;
     if (freq < 0.0) {
         freq = 2 * TMath::Pi() * (double)(zeroCrossings) / (trace.size() - spacing); // Estimate frequency
     }
 
     // Estimate the phase from the first zero crossing
-    double phase = 0.0;
+    phase = 0.0;
     if (firstPosCrossingTime > 0.0) {
         phase = freq * firstPosCrossingTime;
     }
+}
+
+void RFFitter::PerformLinearRFFit(const dataProducts::WFD5Waveform* waveform, dataProducts::RFWaveformFit* fitResult) const {
+    const auto& trace = waveform->trace;
+
+    double freq = frequency_;
+    if (freq < 0.0 && !trace.empty()) {
+        double amplitude, phase, baseline;
+        EstimateParameters(trace, freq, amplitude, phase, baseline);
+    }
+
+    int first, last;
+    FitWindow(trace.size(), first, last);
+
+    // Reuse the basis of the configured frequency; an estimated frequency needs its own
+    RFLinearFit::Result fit;
+    if (frequency_ > 0.0) {
+        fit = GetBasis(first, last).Fit(trace.data());
+    } else {
+        RFLinearFit local;
+        local.SetBasis(freq, first, last);
+        fit = local.Fit(trace.data());
+    }
+
+    FillLinearResult(fit, freq, trace.size(), fitResult);
+}
+
+const RFLinearFit& RFFitter::GetBasis(int first, int last) const {
+    std::lock_guard<std::mutex> lock(bases_->mutex);
+    auto [it, inserted] = bases_->bases.try_emplace({first, last});
+    if (inserted) {
+        it->second.SetBasis(frequency_, first, last);
+    }
+    return it->second;
+}
+
+void RFFitter::PerformTrackedRFFit(const dataProducts::WFD5Waveform* waveform, dataProducts::RFWaveformFit* fitResult) const {
+    const auto& trace = waveform->trace;
+    int first, last;
+    FitWindow(trace.size(), first, last);
+
+    double freq = 0.0;
+    RFLinearFit::Result fit = phaseTracker_->Update(waveform->GetID(), trace.data(), first, last, freq);
+
+    FillLinearResult(fit, freq, trace.size(), fitResult);
+}
+
+void RFFitter::FillLinearResult(const RFLinearFit::Result& fit, double freq, size_t traceSize, dataProducts::RFWaveformFit* fitResult) const {
+    fitResult->frequency = freq;
+    fitResult->chi2 = fit.chi2;
+    fitResult->ndf = fit.ndf;
+    fitResult->converged = fit.valid;
+    fitResult->amplitude = fit.Amplitude();
+    fitResult->phase = fit.Phase();
+    fitResult->pedestalLevel = fit.c;
+
+    if (storeFitFunction_) {
+        TF1 fitFunc("fitFunc", "[1]*cos(x*[0]) + [2]*sin([0]*x) + [3]", 0, traceSize);
+        fitFunc.SetParameters(freq, fit.a, fit.b, fit.c);
+        fitResult->SetFitFunc(std::move(fitFunc));
+    }
+}
+
+void RFFitter::PerformRFFit(const dataProducts::WFD5Waveform* waveform, dataProducts::RFWaveformFit* fitResult) const {
+    // std::cout << "Performing RF fit for waveform with index: " << waveform->waveformIndex << std::endl;
+
+    // Get the trace
+    auto trace = waveform->trace;
+
+    // Make a TGraph
+    TGraph* graph = new TGraph(trace.size());
+    for (size_t i = 0; i < trace.size(); ++i) {
+        graph->SetPoint(i, i, trace[i]);
+    }
+
+    // Make the fit function
+    TF1 fitFunc("fitFunc", "[1]*cos(x*[0]) + [2]*sin([0]*x) + [3]", 0, trace.size());
+
+    double freq, amplitude, phase, baseline;
+    EstimateParameters(trace, freq, amplitude, phase, baseline);
 
     // std::cout << "Estimated frequency: " << freq << ", phase: " << phase << ", A*cos: " <<  amplitude*TMath::Cos(phase) << ", -A*sin: " << -amplitude*TMath::Sin(phase) << ", amplitude: " << amplitude << ", baseline: " << baseline << std::endl;
 
@@ -113,7 +214,9 @@ void RFFitter::PerformRFFit(const dataProducts::WFD5Waveform* waveform, dataProd
     fitResult->pedestalLevel = fitFunc.GetParameter(3);
 
     // Set the fit function
-    fitResult->SetFitFunc(std::move(fitFunc));
+    if (storeFitFunction_) {
+        fitResult->SetFitFunc(std::move(fitFunc));
+    }
 
     // Clean up
     delete graph;
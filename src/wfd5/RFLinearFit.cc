@@ -0,0 +1,92 @@
+#include "reco/wfd5/RFLinearFit.hh"
+
+#include <cmath>
+
+using namespace reco;
+
+double RFLinearFit::Result::Amplitude() const {
+    return std::sqrt(a * a + b * b);
+}
+
+double RFLinearFit::Result::Phase() const {
+    return std::atan2(b, a);
+}
+
+void RFLinearFit::SetBasis(double frequency, int first, int last) {
+    frequency_ = frequency;
+    first_ = first;
+    cos_.clear();
+    sin_.clear();
+    valid_ = false;
+    if (last - first + 1 < 3) return;
+
+    // Normal matrix of the columns cos(wx), sin(wx), 1. The table is advanced by rotation,
+    // restarted from std::cos/std::sin every 64 samples to keep the rounding error down.
+    double m[3][3] = {};
+    const double stepCos = std::cos(frequency);
+    const double stepSin = std::sin(frequency);
+    double c = 0.0, s = 0.0;
+    cos_.reserve(last - first + 1);
+    sin_.reserve(last - first + 1);
+    for (int x = first; x <= last; ++x) {
+        if ((x - first) % 64 == 0) {
+            c = std::cos(frequency * x);
+            s = std::sin(frequency * x);
+        } else {
+            double next = c * stepCos - s * stepSin;
+            s = s * stepCos + c * stepSin;
+            c = next;
+        }
+        cos_.push_back(c);
+        sin_.push_back(s);
+        m[0][0] += c * c;
+        m[0][1] += c * s;
+        m[0][2] += c;
+        m[1][1] += s * s;
+        m[1][2] += s;
+    }
+    m[2][2] = last - first + 1;
+
+    // Symmetric, so the inverse is the cofactor matrix over the determinant
+    double cof[3][3];
+    cof[0][0] = m[1][1] * m[2][2] - m[1][2] * m[1][2];
+    cof[0][1] = m[0][2] * m[1][2] - m[0][1] * m[2][2];
+    cof[0][2] = m[0][1] * m[1][2] - m[0][2] * m[1][1];
+    cof[1][1] = m[0][0] * m[2][2] - m[0][2] * m[0][2];
+    cof[1][2] = m[0][1] * m[0][2] - m[0][0] * m[1][2];
+    cof[2][2] = m[0][0] * m[1][1] - m[0][1] * m[0][1];
+    double det = m[0][0] * cof[0][0] + m[0][1] * cof[0][1] + m[0][2] * cof[0][2];
+    if (std::abs(det) < 1e-9 * m[2][2] * m[2][2] * m[2][2]) return; // e.g. w a multiple of pi
+
+    for (int r = 0; r < 3; ++r) {
+        for (int k = r; k < 3; ++k) {
+            inverse_[r][k] = inverse_[k][r] = cof[r][k] / det;
+        }
+    }
+    valid_ = true;
+}
+
+RFLinearFit::Result RFLinearFit::Fit(const short* trace) const {
+    Result result;
+    const size_t n = cos_.size();
+    result.ndf = n > 3 ? static_cast<int>(n) - 3 : 0;
+    if (!valid_) return result;
+
+    const short* y = trace + first_;
+    double sumCos = 0.0, sumSin = 0.0, sum = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+        sumCos += cos_[j] * y[j];
+        sumSin += sin_[j] * y[j];
+        sum += y[j];
+    }
+    result.a = inverse_[0][0] * sumCos + inverse_[0][1] * sumSin + inverse_[0][2] * sum;
+    result.b = inverse_[1][0] * sumCos + inverse_[1][1] * sumSin + inverse_[1][2] * sum;
+    result.c = inverse_[2][0] * sumCos + inverse_[2][1] * sumSin + inverse_[2][2] * sum;
+
+    for (size_t j = 0; j < n; ++j) {
+        double residual = y[j] - (result.a * cos_[j] + result.b * sin_[j] + result.c);
+        result.chi2 += residual * residual;
+    }
+    result.valid = true;
+    return result;
+}
@@ -0,0 +1,83 @@
+#include "reco/wfd5/RFPhaseTrackerService.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include <TMath.h>
+
+using namespace reco;
+
+void RFPhaseTrackerService::Configure(const nlohmann::json& config, EventStore& eventStore) {
+    frequency_ = config.value("frequency", -1.0);
+    gain_ = config.value("gain", 0.2);
+    maxStep_ = config.value("maxStep", 1e-3);
+    minAmplitude_ = config.value("minAmplitude", 0.0);
+    debug_ = config.value("debug", false);
+
+    if (frequency_ <= 0.0) {
+        throw std::runtime_error("RFPhaseTrackerService: 'frequency' (rad/sample) must be given and positive");
+    }
+    if (gain_ < 0.0 || gain_ > 1.0) {
+        throw std::runtime_error("RFPhaseTrackerService: 'gain' must be between 0 and 1");
+    }
+
+    std::cout << "-> reco::RFPhaseTrackerService: Tracking from " << frequency_ << " rad/sample with gain " << gain_ << std::endl;
+}
+
+RFLinearFit::Result RFPhaseTrackerService::Update(dataProducts::ChannelID id, const short* trace, int first, int last, double& frequency) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = channels_.find(id);
+        frequency = it == channels_.end() ? frequency_ : it->second.frequency;
+    }
+
+    RFLinearFit window;
+    window.SetBasis(frequency, first, last);
+    RFLinearFit::Result result = window.Fit(trace);
+    if (!result.valid) return result;
+
+    // Phase drift between the two halves of the window
+    int mid = (first + last) / 2;
+    RFLinearFit firstHalf, secondHalf;
+    firstHalf.SetBasis(frequency, first, mid);
+    secondHalf.SetBasis(frequency, mid + 1, last);
+    RFLinearFit::Result early = firstHalf.Fit(trace);
+    RFLinearFit::Result late = secondHalf.Fit(trace);
+    if (!early.valid || !late.valid || early.Amplitude() < minAmplitude_ || late.Amplitude() < minAmplitude_) {
+        return result;
+    }
+    double drift = std::remainder(late.Phase() - early.Phase(), 2 * TMath::Pi());
+    double distance = 0.5 * ((mid + 1 + last) - (first + mid));
+    double step = std::clamp(-gain_ * drift / distance, -maxStep_, maxStep_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& state = channels_.try_emplace(id, ChannelState{frequency_}).first->second;
+    state.frequency += step;
+    state.lastStep = step;
+    state.nUpdates++;
+    if (debug_) {
+        std::cout << "-> reco::RFPhaseTrackerService: Channel " << std::get<0>(id) << "/" << std::get<1>(id) << "/" << std::get<2>(id)
+                  << " phase " << result.Phase() << ", frequency " << state.frequency << " (step " << step << ")" << std::endl;
+    }
+    return result;
+}
+
+double RFPhaseTrackerService::GetFrequency(dataProducts::ChannelID id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = channels_.find(id);
+    return it == channels_.end() ? frequency_ : it->second.frequency;
+}
+
+void RFPhaseTrackerService::EndOfJobPrint() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::cout << "-> reco::RFPhaseTrackerService: Tracked RF frequencies (rad/sample)" << std::endl;
+    for (const auto& [id, state] : channels_) {
+        std::cout << "   " << std::get<0>(id) << "/" << std::get<1>(id) << "/" << std::get<2>(id)
+                  << std::setprecision(8) << "  frequency " << state.frequency
+                  << std::setprecision(3) << "  last step " << state.lastStep
+                  << "  updates " << state.nUpdates << std::endl;
+    }
+    std::cout << std::setprecision(6);
+}
@@ -0,0 +1,38 @@
+#include "reco/wfd5/SlowFitRecorder.hh"
+
+#include <algorithm>
+
+using namespace reco;
+
+namespace {
+    bool Slower(const SlowFitRecorder::Entry& a, const SlowFitRecorder::Entry& b) {
+        return a.fitTime > b.fitTime;
+    }
+}
+
+SlowFitRecorder::SlowFitRecorder(size_t capacity) : capacity_(capacity) {
+    heap_.reserve(capacity_);
+}
+
+void SlowFitRecorder::Add(Entry entry) {
+    if (capacity_ == 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (heap_.size() == capacity_) {
+        if (entry.fitTime <= heap_.front().fitTime) return;
+        std::pop_heap(heap_.begin(), heap_.end(), Slower);
+        heap_.back() = std::move(entry);
+    } else {
+        heap_.push_back(std::move(entry));
+    }
+    std::push_heap(heap_.begin(), heap_.end(), Slower);
+    if (heap_.size() == capacity_) {
+        threshold_.store(heap_.front().fitTime, std::memory_order_relaxed);
+    }
+}
+
+std::vector<SlowFitRecorder::Entry> SlowFitRecorder::GetSlowest() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Entry> entries = heap_;
+    std::sort(entries.begin(), entries.end(), Slower);
+    return entries;
+}
@@ -8,6 +8,8 @@ void T0Processor::Configure(const nlohmann::json& config, const ServiceManager&
     inputRecoLabel_ = config.value("inputRecoLabel", "unpacker");
     inputWaveformsLabel_ = config.value("inputWaveformsLabel", "WFD5WaveformCollection");
     outputT0TimeRefLabel_ = config.value("outputT0TimeRefLabel", "t0");
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputT0TimeRef_ = Produces<dataProducts::TimeSeed>(eventStore, outputT0TimeRefLabel_);
 
     failOnError_ = config.value("failOnError", false);
     debug_ = config.value("debug",false);
@@ -32,19 +34,28 @@ void T0Processor::Configure(const nlohmann::json& config, const ServiceManager&
     }
 
     if (debug_) std::cout << "Getting the T0 channel:" << std::endl;
+
+    // Search each distinct subdetector name once, then compare the channels' ids
+    const NameTable& names = channelMapService->GetNames();
+    std::vector<bool> isT0(names.size());
+    for (size_t id = 0; id < names.size(); ++id) {
+        isT0[id] = names.GetName(id).find("T0") != std::string::npos;
+    }
+
     int nt0 = 0;
-    for (auto& map_entry:channelMapService->GetChannelMap())
+    const ChannelIndex& channels = *channelMapService->GetChannelIndex();
+    for (size_t c = 0; c < channels.size(); ++c)
     {
-        if (map_entry.second.GetSubdetector().find("T0") != std::string::npos)
+        if (isT0[channelMapService->GetSubdetectorId(c)])
         {
             nt0 += 1;
-            t0Channel_ = map_entry.first;
+            t0Channel_ = channels.GetID(c);
             if (debug_) std::cout << "   -> found t0 channel in config with labels " 
-                << map_entry.second.GetDetectorSystem() << " / " << map_entry.second.GetSubdetector() 
+                << names.GetName(channelMapService->GetDetectorSystemId(c)) << " / " << names.GetName(channelMapService->GetSubdetectorId(c)) 
                 << " -> ("
-                << std::get<0>(map_entry.first) << " / "
-                << std::get<1>(map_entry.first) << " / "
-                << std::get<2>(map_entry.first) << ")"
+                << std::get<0>(t0Channel_) << " / "
+                << std::get<1>(t0Channel_) << " / "
+                << std::get<2>(t0Channel_) << ")"
                 << std::endl;
         }
     }
@@ -71,11 +82,11 @@ void T0Processor::Process(EventStore& store, const ServiceManager& serviceManage
     // std::cout << "T0Processor with name '" << GetRecoLabel() << "' is processing...\n";
     try {
          // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
+        auto waveforms = store.get(inputWaveforms_);
         int peakIndex;
 
         //Make a collection new waveforms
-        auto output = store.getOrCreate<dataProducts::TimeSeed>(this->GetRecoLabel(), outputT0TimeRefLabel_);
+        auto output = store.getOrCreate(outputT0TimeRef_);
         dataProducts::TimeSeed* seed = new ((*output)[0]) dataProducts::TimeSeed();
         output->Expand(1);
 
@@ -0,0 +1,49 @@
+#include "reco/common/ServiceManager.hh"
+#include "reco/wfd5/TemplateFitterService.hh"
+
+using namespace reco;
+
+TemplateFitterService::FitterLease::FitterLease(FitterPool* pool, std::unique_ptr<TemplateFit> fitter)
+    : pool_(pool), fitter_(std::move(fitter)) {}
+
+TemplateFitterService::FitterLease& TemplateFitterService::FitterLease::operator=(FitterLease&& other) noexcept {
+    if (this != &other) {
+        Release();
+        pool_ = other.pool_;
+        fitter_ = std::move(other.fitter_);
+    }
+    return *this;
+}
+
+TemplateFitterService::FitterLease::~FitterLease() {
+    Release();
+}
+
+void TemplateFitterService::FitterLease::Release() {
+    if (pool_ && fitter_) {
+        std::lock_guard<std::mutex> lock(pool_->mutex);
+        pool_->idle.push_back(std::move(fitter_));
+    }
+    fitter_.reset();
+}
+
+TemplateFitterService::FitterLease TemplateFitterService::GetFitter(dataProducts::ChannelID id) const {
+    FitterPool* const* entry = poolTable_.Find(id);
+    if (!entry) {
+        throw std::runtime_error("TemplateFitterService: No fitter for channel " + std::to_string(std::get<0>(id)) + "/" +
+                                 std::to_string(std::get<1>(id)) + "/" + std::to_string(std::get<2>(id)));
+    }
+    FitterPool* pool = *entry;
+
+    {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        if (!pool->idle.empty()) {
+            std::unique_ptr<TemplateFit> fitter = std::move(pool->idle.back());
+            pool->idle.pop_back();
+            return FitterLease(pool, std::move(fitter));
+        }
+    }
+
+    // Nothing free: this is a new concurrent user, give it its own copy
+    return FitterLease(pool, std::make_unique<TemplateFit>(*pool->prototype));
+}
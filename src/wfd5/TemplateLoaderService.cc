@@ -31,6 +31,10 @@ void TemplateLoaderService::Configure(const nlohmann::json& config, EventStore&
     // Set the splines
     std::string infile = templateConfig_["file"];
     LoadSplines(infile);
+
+    // Tabulate the templates for the fitters
+    tablePointsPerSample_ = config.value("tablePointsPerSample", 16.0);
+    BuildTables();
     
     eventStore.putSplines(
         config.value("label","templateLoader"),
@@ -87,6 +91,43 @@ fitter::CubicSpline* TemplateLoaderService::GetSpline(dataProducts::ChannelID id
     return splineHolder_->GetSpline(id, 0);
 }
 
+void TemplateLoaderService::BuildTables()
+{
+    tables_.clear();
+    segments_.clear();
+    for (const auto& id : GetValidChannels())
+    {
+        TSpline3* tSpline = GetTemplate(id);
+        fitter::CubicSpline* spline = GetSpline(id);
+        if (!tSpline || !spline || tSpline->GetNp() < 2) continue;
+
+        // The fitter::CubicSpline is built on the knots of the TSpline3
+        std::vector<double> knots(tSpline->GetNp());
+        double y;
+        for (int i = 0; i < tSpline->GetNp(); ++i) tSpline->GetKnot(i, knots[i], y);
+        segments_[id] = std::make_unique<SplineSegments>(*spline, knots);
+
+        // Tabulate over the knot range
+        double xMin = knots.front(), xMax = knots.back();
+        tables_[id] = std::make_unique<TemplateTable>(*segments_[id], tablePointsPerSample_);
+
+        if (debug_) std::cout << "   -> Built template table for " << std::get<0>(id) << "/" << std::get<1>(id) << "/" << std::get<2>(id)
+                              << " on [" << xMin << ", " << xMax << "] with " << tables_[id]->GetNIntervals() << " intervals" << std::endl;
+    }
+}
+
+const TemplateTable* TemplateLoaderService::GetTable(dataProducts::ChannelID id) const
+{
+    auto it = tables_.find(id);
+    return it == tables_.end() ? nullptr : it->second.get();
+}
+
+const SplineSegments* TemplateLoaderService::GetSegments(dataProducts::ChannelID id) const
+{
+    auto it = segments_.find(id);
+    return it == segments_.end() ? nullptr : it->second.get();
+}
+
 fitter::CubicSpline* TemplateLoaderService::buildCubicSpline(const TSpline3* tSpline, fitter::CubicSpline::BoundaryType cond  = fitter::CubicSpline::BoundaryType::first) 
 {
     unsigned int nKnots = tSpline->GetNp();
@@ -15,6 +15,11 @@ void TimeSeeder::Configure(const nlohmann::json& config, const ServiceManager& s
     seedFromConfig_ = config.value("seedFromConfig", false);
     defaultSeed_ = config.value("defaultSeed", 100.0);
 
+    if (seedFromMaxAmplitudeFit_ || seedFromFirstFit_) {
+        inputFitResults_ = Consumes<dataProducts::WaveformFit>(eventStore, inputRecoLabel_, inputFitResultsLabel_);
+    }
+    outputSeed_ = Produces<dataProducts::TimeSeed>(eventStore, outputSeedLabel_);
+
     std::vector<bool> options = {
         seedFromMaxAmplitudeFit_,
         seedFromFirstFit_,
@@ -46,7 +51,7 @@ void TimeSeeder::Process(EventStore& store, const ServiceManager& serviceManager
     // std::cout << "TimeSeeder with name '" << GetRecoLabel() << "' is processing...\n";
     try {
          // Get the input waveforms
-         auto output = store.getOrCreate<dataProducts::TimeSeed>(this->GetRecoLabel(), outputSeedLabel_);
+         auto output = store.getOrCreate(outputSeed_);
          int i = 0;
          dataProducts::TimeSeed* seed = new ((*output)[i]) dataProducts::TimeSeed();
          output->Expand(i + 1);
@@ -58,7 +63,7 @@ void TimeSeeder::Process(EventStore& store, const ServiceManager& serviceManager
 
             // get the first fit from the first object in the collection
 
-            auto input = store.get<const dataProducts::WaveformFit>(inputRecoLabel_, inputFitResultsLabel_);
+            auto input = store.get(inputFitResults_);
             auto* fiti = static_cast<dataProducts::WaveformFit*>(input->ConstructedAt(0));
 
             seed->SetSeed(fiti->GetClosestPulseTime(-1e10)); // TODO: update for various time corrections, etc.
@@ -68,7 +73,7 @@ void TimeSeeder::Process(EventStore& store, const ServiceManager& serviceManager
         {
             if (debug_) std::cout << "Seeding with option: seedFromMaxAmplitudeFit_" << std::endl;
             throw std::runtime_error("Not implemented");
-            auto input = store.get<const dataProducts::WaveformFit>(inputRecoLabel_, inputFitResultsLabel_);
+            auto input = store.get(inputFitResults_);
         }
         else if (seedFromConfig_)
         {
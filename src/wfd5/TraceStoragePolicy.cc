@@ -0,0 +1,89 @@
+#include "reco/wfd5/TraceStoragePolicy.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+#include <data_products/wfd5/WFD5WaveformFit.hh>
+
+using namespace reco;
+
+TraceStoragePolicy::TraceStoragePolicy(const nlohmann::json& config) {
+    if (!config.contains("collections") || !config["collections"].is_array()) {
+        throw std::runtime_error("TraceStoragePolicy: 'collections' must be an array of patterns");
+    }
+    collections_ = CollectionMatcher(config["collections"].get<std::vector<std::string>>());
+    fitsLabel_ = config.value("fits", std::string());
+
+    prescale_ = config.value("prescale", 0);
+    if (config.contains("keepIfChi2Above")) chi2Threshold_ = config["keepIfChi2Above"].get<double>();
+    keepTimeouts_ = config.value("keepIfTimeout", false);
+    if (config.contains("keepIfPulsesAbove")) maxPulses_ = config["keepIfPulsesAbove"].get<int>();
+
+    std::string otherwise = config.value("otherwise", std::string("window"));
+    if (otherwise == "window") {
+        reduction_ = Reduction::kWindow;
+    } else if (otherwise == "none") {
+        reduction_ = Reduction::kNone;
+    } else {
+        throw std::runtime_error("TraceStoragePolicy: 'otherwise' must be 'window' or 'none', not '" + otherwise + "'");
+    }
+    windowBefore_ = config.value("windowBefore", 10);
+    windowAfter_ = config.value("windowAfter", 40);
+
+    if (fitsLabel_.empty() && (reduction_ == Reduction::kWindow || std::isfinite(chi2Threshold_)
+                               || keepTimeouts_ || maxPulses_ != std::numeric_limits<int>::max())) {
+        throw std::runtime_error("TraceStoragePolicy: 'fits' is needed for the fit predicates and for 'window'");
+    }
+
+    std::cout << "-> reco::TraceStoragePolicy: Full traces every " << prescale_ << " events and for selected fits, '"
+              << otherwise << "' otherwise." << std::endl;
+}
+
+TraceStoragePolicy::Decision TraceStoragePolicy::Decide(const EventStore& eventStore, Long64_t event) const {
+    Decision decision;
+    decision.fullTraces = prescale_ > 0 && event % prescale_ == 0;
+    if (decision.fullTraces || fitsLabel_.empty()) {
+        return decision;
+    }
+
+    const auto& buffers = eventStore.GetBuffers();
+    auto it = buffers.find(fitsLabel_);
+    TClonesArray* fits = it == buffers.end() ? nullptr : it->second;
+    for (int i = 0; fits && i < fits->GetEntriesFast(); ++i) {
+        auto* fit = static_cast<const dataProducts::WaveformFit*>(fits->At(i));
+        if (fit->chi2 > chi2Threshold_ || (keepTimeouts_ && fit->timeout)
+            || static_cast<int>(fit->times.size()) > maxPulses_) {
+            decision.fullTraces = true;
+            decision.pulseTimes.clear();
+            return decision;
+        }
+        if (reduction_ == Reduction::kWindow) {
+            auto& times = decision.pulseTimes[fit->GetID()];
+            times.insert(times.end(), fit->times.begin(), fit->times.end());
+        }
+    }
+    return decision;
+}
+
+void TraceStoragePolicy::Reduce(const Decision& decision, const dataProducts::WFD5Waveform& waveform,
+                                const std::vector<short>& trace, std::vector<short>& out) const {
+    if (decision.fullTraces) {
+        out = trace;
+        return;
+    }
+    if (reduction_ == Reduction::kNone) {
+        out.clear();
+        return;
+    }
+
+    out.assign(trace.size(), static_cast<short>(std::lround(waveform.pedestalLevel)));
+    auto it = decision.pulseTimes.find(waveform.GetID());
+    if (it == decision.pulseTimes.end()) return;
+    for (double time : it->second) {
+        long begin = std::max(0L, static_cast<long>(std::floor(time)) - windowBefore_);
+        long end = std::min(static_cast<long>(trace.size()), static_cast<long>(std::ceil(time)) + windowAfter_ + 1);
+        if (begin < end) std::copy(trace.begin() + begin, trace.begin() + end, out.begin() + begin);
+    }
+}
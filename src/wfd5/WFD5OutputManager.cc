@@ -5,7 +5,14 @@ using namespace reco;
 WFD5OutputManager::WFD5OutputManager(const std::string& filename)
     : OutputManager(filename) {}
 
-WFD5OutputManager::~WFD5OutputManager() {}
+WFD5OutputManager::~WFD5OutputManager() {
+    // The base class writes the tree after the packed traces are gone
+    for (const auto& [name, collection] : traceCollections_) {
+        if (TBranch* branch = collection.packed ? tree_->GetBranch(("packed_" + name).c_str()) : nullptr) {
+            tree_->ResetBranchAddress(branch);
+        }
+    }
+}
 
 void WFD5OutputManager::WriteODB(const EventStore& eventStore) {
     file_->cd();
@@ -15,3 +22,92 @@ void WFD5OutputManager::WriteODB(const EventStore& eventStore) {
     }
     file_->WriteObject(odb, "wfd5_odb");
 };
+
+// protected:
+
+void WFD5OutputManager::ConfigureOutput(const nlohmann::json& outputConfig) {
+    // WFD5Waveform collections to write with packed traces
+    std::vector<std::string> packList;
+    if (outputConfig.contains("packTraces")) {
+        if (!outputConfig["packTraces"].is_array()) {
+            throw std::runtime_error("WFD5OutputManager: 'packTraces' must be an array in 'Output' config");
+        }
+        packList = outputConfig["packTraces"].get<std::vector<std::string>>();
+    }
+    packMatcher_ = CollectionMatcher(packList);
+
+    // Which events keep their full traces
+    tracePolicy_.reset();
+    if (outputConfig.contains("tracePolicy")) {
+        tracePolicy_ = std::make_unique<TraceStoragePolicy>(outputConfig["tracePolicy"]);
+    }
+}
+
+void WFD5OutputManager::BranchCreated(const std::string& name, TClonesArray* buffer) {
+    if (buffer->GetClass()->InheritsFrom(dataProducts::WFD5Waveform::Class())) {
+        bool pack = packMatcher_.Matches(name);
+        bool reduce = tracePolicy_ && tracePolicy_->Applies(name);
+        if (pack || reduce) {
+            auto& collection = traceCollections_[name];
+            collection.reduce = reduce;
+            if (reduce) {
+                std::cout << "-> reco::WFD5OutputManager: Traces of '" << name << "' follow the trace storage policy." << std::endl;
+            }
+        }
+        // The packed traces go in a branch of their own ("packed_" cannot clash with a collection label)
+        if (pack) {
+            auto& collection = traceCollections_[name];
+            collection.packed = std::make_unique<PackedTraces>();
+            collection.slot = collection.packed.get();
+            tree_->Branch(("packed_" + name).c_str(), &collection.slot);
+            std::cout << "-> reco::WFD5OutputManager: Traces of '" << name << "' will be packed into branch 'packed_" << name << "'." << std::endl;
+        }
+    }
+}
+
+void WFD5OutputManager::PrepareFill(const EventStore& eventStore) {
+    if (traceCollections_.empty()) return;
+
+    TraceStoragePolicy::Decision decision;
+    if (tracePolicy_) {
+        decision = tracePolicy_->Decide(eventStore, tree_->GetEntries());
+    }
+
+    for (auto& [name, collection] : traceCollections_) {
+        bool reduce = collection.reduce && !decision.fullTraces;
+        collection.swapped = reduce || collection.packed;
+        if (!collection.swapped) continue;
+
+        TClonesArray* waveforms = branchBuffers_.at(name);
+        if (collection.packed) collection.packed->Clear();
+        collection.stash.resize(waveforms->GetEntriesFast());
+        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
+            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->At(i));
+            auto& full = collection.stash[i];
+            full.swap(waveform->trace);
+
+            // The waveform is left with the trace to write, or none when it goes to the packed branch
+            if (reduce) {
+                tracePolicy_->Reduce(decision, *waveform, full, waveform->trace);
+                if (collection.packed) {
+                    collection.packed->Add(waveform->trace);
+                    waveform->trace.clear();
+                }
+            } else {
+                waveform->trace.clear();
+                collection.packed->Add(full);
+            }
+        }
+    }
+}
+
+void WFD5OutputManager::FinishFill() {
+    for (auto& [name, collection] : traceCollections_) {
+        if (!collection.swapped) continue;
+        TClonesArray* waveforms = branchBuffers_.at(name);
+        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
+            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->At(i));
+            collection.stash[i].swap(waveform->trace);
+        }
+    }
+}
@@ -0,0 +1,254 @@
+#include "reco/wfd5/WaveformBatch.hh"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+using namespace reco;
+
+const WaveformBatch& WaveformBatch::Get(EventStore& store, const Handle& handle) {
+    if (auto* batch = store.findBatch<WaveformBatch>(handle)) {
+        if (!batch->IsView() || batch->sources_) {
+            return *batch;
+        }
+    }
+
+    // A plain collection (e.g. from the unpacker): wrap it once per event
+    std::lock_guard<std::mutex> lock(store.GetSetupMutex());
+    WaveformBatch& view = store.getOrCreateBatch<WaveformBatch>(handle);
+    if (!view.sources_) {
+        view.SetView(true);
+        view.WrapCollection(static_cast<const EventStore&>(store).get(handle));
+    }
+    return view;
+}
+
+WaveformBatch& WaveformBatch::Create(EventStore& store, const Handle& handle) {
+    WaveformBatch& batch = store.getOrCreateBatch<WaveformBatch>(handle);
+    if (batch.IsView()) {
+        throw std::runtime_error("WaveformBatch: '" + handle.GetLabel() + "' already holds a collection");
+    }
+    batch.Clear();
+    return batch;
+}
+
+WaveformBatch& WaveformBatch::Derive(EventStore& store, const Handle& input, const Handle& output) {
+    const WaveformBatch& inputBatch = Get(store, input);
+    if (output.GetIndex() != input.GetIndex()) {
+        WaveformBatch& outputBatch = Create(store, output);
+        outputBatch.ShareFrom(inputBatch);
+        return outputBatch;
+    }
+
+    if (inputBatch.IsView()) {
+        throw std::runtime_error("WaveformBatch: '" + input.GetLabel() + "' is not a batch and cannot be modified in place");
+    }
+    store.MarkModified(input);
+    return *store.findBatch<WaveformBatch>(input);
+}
+
+void WaveformBatch::WrapCollection(TClonesArray* collection) {
+    auto sources = std::make_shared<std::vector<const dataProducts::WFD5Waveform*>>();
+    sources->reserve(collection->GetEntriesFast());
+    for (int i = 0; i < collection->GetEntriesFast(); ++i) {
+        auto* waveform = static_cast<const dataProducts::WFD5Waveform*>(collection->At(i));
+        if (!waveform) {
+            throw std::runtime_error("WaveformBatch: Failed to retrieve waveform at index " + std::to_string(i));
+        }
+        sources->push_back(waveform);
+    }
+    sources_ = std::move(sources);
+    traces_.reset();
+    metadata_.reset();
+    rows_.resize(sources_->size());
+    for (size_t i = 0; i < rows_.size(); ++i) rows_[i] = i;
+}
+
+void WaveformBatch::ShareFrom(const WaveformBatch& other) {
+    sources_ = other.sources_;
+    traces_ = other.traces_;
+    metadata_ = other.metadata_;
+    rows_ = other.rows_;
+}
+
+void WaveformBatch::ShareRowsFrom(const WaveformBatch& other, const std::vector<size_t>& rows) {
+    sources_ = other.sources_;
+    traces_ = other.traces_;
+    metadata_ = other.metadata_;
+    rows_.clear();
+    rows_.reserve(rows.size());
+    for (size_t i : rows) rows_.push_back(other.rows_.at(i));
+}
+
+const short* WaveformBatch::Trace(size_t i) const {
+    if (traces_) return traces_->samples.data() + traces_->offsets[rows_[i]];
+    return Source(i).trace.data();
+}
+
+size_t WaveformBatch::TraceLength(size_t i) const {
+    if (traces_) return traces_->offsets[rows_[i] + 1] - traces_->offsets[rows_[i]];
+    return Source(i).trace.size();
+}
+
+short* WaveformBatch::MutableTrace(size_t i) {
+    return WritableTraces().samples.data() + traces_->offsets[rows_[i]];
+}
+
+WaveformBatch::TraceColumn& WaveformBatch::WritableTraces() {
+    if (traces_ && traces_.use_count() == 1) return *traces_;
+
+    auto traces = std::make_shared<TraceColumn>();
+    if (traces_) {
+        *traces = *traces_;
+    } else {
+        // First write: gather the sources' traces into one buffer
+        traces->offsets.reserve(sources_->size() + 1);
+        traces->offsets.push_back(0);
+        for (const auto* source : *sources_) traces->offsets.push_back(traces->offsets.back() + source->trace.size());
+        traces->samples.resize(traces->offsets.back());
+        for (size_t r = 0; r < sources_->size(); ++r) {
+            std::copy((*sources_)[r]->trace.begin(), (*sources_)[r]->trace.end(), traces->samples.begin() + traces->offsets[r]);
+        }
+    }
+    traces_ = std::move(traces);
+    return *traces_;
+}
+
+WaveformBatch::MetadataColumns& WaveformBatch::WritableMetadata() {
+    if (metadata_ && metadata_.use_count() == 1) return *metadata_;
+
+    auto metadata = std::make_shared<MetadataColumns>();
+    if (metadata_) {
+        *metadata = *metadata_;
+    } else {
+        size_t n = sources_->size();
+        metadata->set.assign(n, 0);
+        metadata->run.resize(n);
+        metadata->subrun.resize(n);
+        metadata->frequency.resize(n);
+        metadata->pedestalLevel.resize(n);
+        metadata->pedestalStdev.resize(n);
+        metadata->pedestalStart.resize(n);
+        metadata->pedestalEnd.resize(n);
+        metadata->digitizationShift.resize(n);
+        metadata->timeOffset.resize(n);
+        metadata->placement.resize(n);
+    }
+    metadata_ = std::move(metadata);
+    return *metadata_;
+}
+
+void WaveformBatch::SetRunSubrun(size_t i, int run, int subrun) {
+    auto& m = WritableMetadata();
+    size_t r = rows_[i];
+    m.run[r] = run;
+    m.subrun[r] = subrun;
+    m.set[r] |= kRunSubrun;
+}
+
+void WaveformBatch::SetDigitizationFrequency(size_t i, double frequency) {
+    auto& m = WritableMetadata();
+    size_t r = rows_[i];
+    m.frequency[r] = frequency;
+    m.set[r] |= kFrequency;
+}
+
+void WaveformBatch::SetPedestal(size_t i, double level, double stdev, int startSample, int endSample) {
+    auto& m = WritableMetadata();
+    size_t r = rows_[i];
+    m.pedestalLevel[r] = level;
+    m.pedestalStdev[r] = stdev;
+    m.pedestalStart[r] = startSample;
+    m.pedestalEnd[r] = endSample;
+    m.set[r] |= kPedestal;
+}
+
+void WaveformBatch::SetTimeAlignment(size_t i, int digitizationShift, double timeOffset) {
+    auto& m = WritableMetadata();
+    size_t r = rows_[i];
+    m.digitizationShift[r] = digitizationShift;
+    m.timeOffset[r] = timeOffset;
+    m.set[r] |= kTimeAlignment;
+}
+
+void WaveformBatch::SetPlacement(size_t i, const Placement* placement) {
+    auto& m = WritableMetadata();
+    size_t r = rows_[i];
+    m.placement[r] = placement;
+    m.set[r] |= kPlacement;
+}
+
+// Apply in the order the stages run: initializer, (jitter) trace, pedestal, time alignment, grouping
+void WaveformBatch::ApplyColumns(size_t i, dataProducts::WFD5Waveform& wf) const {
+    size_t r = rows_[i];
+    uint8_t set = metadata_ ? metadata_->set[r] : 0;
+    if (set & kRunSubrun) wf.SetRunSubrun(metadata_->run[r], metadata_->subrun[r]);
+    if (set & kFrequency) wf.SetDigitizationFrequency(metadata_->frequency[r]);
+    if (traces_) wf.trace.assign(Trace(i), Trace(i) + TraceLength(i));
+    if (set & kPedestal) {
+        const short* trace = Trace(i);
+        wf.pedestalLevel = metadata_->pedestalLevel[r];
+        wf.pedestalStdev = metadata_->pedestalStdev[r];
+        wf.pedestalSamples.assign(trace + metadata_->pedestalStart[r], trace + metadata_->pedestalEnd[r]);
+        wf.pedestalStartSample = metadata_->pedestalStart[r];
+    }
+    if (set & kTimeAlignment) {
+        wf.digitizationShift = metadata_->digitizationShift[r];
+        wf.SetTimeOffset(metadata_->timeOffset[r]);
+    }
+    if (set & kPlacement) {
+        const Placement& placement = *metadata_->placement[r];
+        wf.SetDetectorSystem(placement.names->GetName(placement.detectorSystem));
+        wf.SetSubdetector(placement.names->GetName(placement.subdetector));
+        wf.x = placement.x;
+        wf.y = placement.y;
+    }
+}
+
+void WaveformBatch::LoadRow(size_t i, dataProducts::WFD5Waveform& scratch) const {
+    const dataProducts::WFD5Waveform& source = Source(i);
+    scratch.crateNum = source.crateNum;
+    scratch.amcNum = source.amcNum;
+    scratch.channelTag = source.channelTag;
+    scratch.eventNum = source.eventNum;
+    scratch.waveformIndex = source.waveformIndex;
+    scratch.clockCounter = source.clockCounter;
+    scratch.length = source.length;
+    scratch.trace = source.trace;
+    scratch.pedestalLevel = source.pedestalLevel;
+    scratch.pedestalStdev = source.pedestalStdev;
+    scratch.pedestalStartSample = source.pedestalStartSample;
+    scratch.pedestalSamples = source.pedestalSamples;
+    scratch.digitizationShift = source.digitizationShift;
+    scratch.SetTimeOffset(source.GetTimeOffset());
+    scratch.SetDetectorSystem(source.GetDetectorSystem());
+    scratch.SetSubdetector(source.GetSubdetector());
+    scratch.x = source.x;
+    scratch.y = source.y;
+    ApplyColumns(i, scratch);
+}
+
+dataProducts::WFD5Waveform* WaveformBatch::MaterializeRow(size_t i, TClonesArray& out) const {
+    int idx = out.GetEntriesFast();
+    auto* waveform = new (out[idx]) dataProducts::WFD5Waveform(&Source(i));
+    out.Expand(idx + 1);
+    ApplyColumns(i, *waveform);
+    return waveform;
+}
+
+TClass* WaveformBatch::GetElementClass() const {
+    return dataProducts::WFD5Waveform::Class();
+}
+
+void WaveformBatch::Materialize(TClonesArray& out) const {
+    for (size_t i = 0; i < size(); ++i) {
+        MaterializeRow(i, out);
+    }
+}
+
+void WaveformBatch::Clear() {
+    sources_.reset();
+    traces_.reset();
+    metadata_.reset();
+    rows_.clear();
+}
@@ -8,34 +8,29 @@ void WaveformInitializer::Configure(const nlohmann::json& config, const ServiceM
     inputRecoLabel_ = config.value("inputRecoLabel", "");
     inputWaveformsLabel_ = config.value("inputWaveformsLabel", "");
     outputWaveformsLabel_ = config.value("outputWaveformsLabel", "");
+    defaultFrequency_ = config.value("defaultDigitizationFrequency", 0.0);
     failOnError_ = config.value("failOnError", false);
     debug_ = config.value("debug",false);
+
+    inputWaveforms_ = Consumes<dataProducts::WFD5Waveform>(eventStore, inputRecoLabel_, inputWaveformsLabel_);
+    outputWaveforms_ = Produces<dataProducts::WFD5Waveform>(eventStore, outputWaveformsLabel_);
 }
 
 void WaveformInitializer::Process(EventStore& store, const ServiceManager& serviceManager) const {
     // std::cout << "WaveformInitializer with name '" << GetRecoLabel() << "' is processing...\n";
     try {
-         // Get the input waveforms
-        auto waveforms = store.get<const dataProducts::WFD5Waveform>(inputRecoLabel_, inputWaveformsLabel_);
-
         // Get the odb
         auto odb = dynamic_cast<dataProducts::WFD5ODB*>(store.GetODB().get());
+        if (!odb && defaultFrequency_ <= 0) {
+            throw std::runtime_error("no WFD5ODB in the event store and no defaultDigitizationFrequency given");
+        }
 
-        //Make a collection new waveforms
-        auto newWaveforms = store.getOrCreate<dataProducts::WFD5Waveform>(this->GetRecoLabel(), outputWaveformsLabel_);
-
-        for (int i = 0; i < waveforms->GetEntriesFast(); ++i) {
-            auto* waveform = static_cast<dataProducts::WFD5Waveform*>(waveforms->ConstructedAt(i));
-            if (!waveform) {
-                throw std::runtime_error("Failed to retrieve waveform at index " + std::to_string(i));
-            }
-            //Make the new waveform
-            dataProducts::WFD5Waveform* newWaveform = new ((*newWaveforms)[i]) dataProducts::WFD5Waveform(waveform);
-            newWaveforms->Expand(i + 1);
-
-            newWaveform->SetRunSubrun(store.GetRun(), store.GetSubrun());
-            newWaveform->SetDigitizationFrequency(odb->GetDigitizationFrequency(waveform->amcNum));
+        //Make a batch of new waveforms sharing the input's traces
+        auto& newWaveforms = WaveformBatch::Derive(store, inputWaveforms_, outputWaveforms_);
 
+        for (size_t i = 0; i < newWaveforms.size(); ++i) {
+            newWaveforms.SetRunSubrun(i, store.GetRun(), store.GetSubrun());
+            newWaveforms.SetDigitizationFrequency(i, odb ? odb->GetDigitizationFrequency(newWaveforms.Source(i).amcNum) : defaultFrequency_);
         }
     } catch (const std::exception& e) {
        throw std::runtime_error(std::string("WaveformInitializer error: ") + e.what());
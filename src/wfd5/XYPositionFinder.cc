@@ -16,6 +16,13 @@ void XYPositionFinder::Configure(const nlohmann::json& config, const ServiceMana
     integrals_ = config.value("integrals", false); // same module can take integrals or fit result
     weighting_ = config.value("weightingMode", 0);
 
+    if (integrals_) {
+        inputIntegrals_ = Consumes<dataProducts::WaveformIntegral>(eventStore, inputRecoLabel_, inputFitResultsLabel_);
+    } else {
+        inputFits_ = Consumes<dataProducts::WaveformFit>(eventStore, inputRecoLabel_, inputFitResultsLabel_);
+    }
+    outputPositions_ = Produces<dataProducts::ClusteredHits>(eventStore, outputPositionLabel_);
+
     // First fit in the pulse train
     useFirstFitinTime_ = config.value("useFirstFitInTime", false);
 
@@ -42,7 +49,7 @@ void XYPositionFinder::Configure(const nlohmann::json& config, const ServiceMana
 }
 
 
-void XYPositionFinder::ProcessIntegralsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster) const
+void XYPositionFinder::ProcessIntegralsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster, ClusterInputs& in) const
 {
     for (int i = 0; i < input->GetEntriesFast(); ++i) {
         auto* waveform = static_cast<dataProducts::WaveformIntegral*>(input->ConstructedAt(i));
@@ -51,13 +58,13 @@ void XYPositionFinder::ProcessIntegralsToXY(TClonesArray* input, dataProducts::C
         }
         thisCluster->inputs.push_back(waveform);
         //Make the new waveform
-        xs.push_back(waveform->x);
-        ys.push_back(waveform->y);
-        energies.push_back(waveform->integral);
+        in.xs.push_back(waveform->x);
+        in.ys.push_back(waveform->y);
+        in.energies.push_back(waveform->integral);
     }
 }
 
-void XYPositionFinder::ProcessFitsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster) const
+void XYPositionFinder::ProcessFitsToXY(TClonesArray* input, dataProducts::ClusteredHits* thisCluster, ClusterInputs& in) const
 {
     for (int i = 0; i < input->GetEntriesFast(); ++i) {
         auto* fit = static_cast<dataProducts::WaveformFit*>(input->ConstructedAt(i));
@@ -67,8 +74,8 @@ void XYPositionFinder::ProcessFitsToXY(TClonesArray* input, dataProducts::Cluste
         thisCluster->inputs.push_back(fit);
         //Make the new waveform
         auto input_wf = (dataProducts::WFD5Waveform*) fit->waveforms[0].GetObject();
-        xs.push_back(input_wf->x);
-        ys.push_back(input_wf->y);
+        in.xs.push_back(input_wf->x);
+        in.ys.push_back(input_wf->y);
         int fit_index = 0;
         if (useFirstFitinTime_)
         {
@@ -89,25 +96,25 @@ void XYPositionFinder::ProcessFitsToXY(TClonesArray* input, dataProducts::Cluste
         {
             throw;
         }
-        energies.push_back(fit->amplitudes[fit_index]);
+        in.energies.push_back(fit->amplitudes[fit_index]);
         thisCluster->fitIndex.push_back(fit_index);
     }
     
 }
 
-void XYPositionFinder::Cluster(dataProducts::ClusteredHits* thisCluster) const
+void XYPositionFinder::Cluster(dataProducts::ClusteredHits* thisCluster, const ClusterInputs& in) const
 {
     double avgX = 0.0;
     double avgY = 0.0;
     if (debug_ ) std::cout << "Performing average of: ";
-    for (int i = 0; i < weights.size(); i++)
+    for (int i = 0; i < in.weights.size(); i++)
     {
-        avgX += xs[i]*weights[i];
-        avgY += ys[i]*weights[i];
-        if (debug_) std:: cout << "[( " << xs[i] << ", " << weights[i] << "), (" << ys[i] << ", " << weights[i] << ")], ";
+        avgX += in.xs[i]*in.weights[i];
+        avgY += in.ys[i]*in.weights[i];
+        if (debug_) std:: cout << "[( " << in.xs[i] << ", " << in.weights[i] << "), (" << in.ys[i] << ", " << in.weights[i] << ")], ";
     }
-    avgX /= weightSum;
-    avgY /= weightSum;
+    avgX /= in.weightSum;
+    avgY /= in.weightSum;
 
     if (debug_) std::cout << std::endl << "Result: (" << avgX << ", " << avgY << ")." << std::endl;
 
@@ -123,14 +130,14 @@ void XYPositionFinder::Process(EventStore& store, const ServiceManager& serviceM
         // TObject* inputObject;
         int i = 0;
         dataProducts::ClusteredHits* thisCluster;
-        auto xyPositions = store.getOrCreate<dataProducts::ClusteredHits>(this->GetRecoLabel(), outputPositionLabel_);
+        auto xyPositions = store.getOrCreate(outputPositions_);
 
         if (debug_) std::cout << "Looking for collection with name: '" << inputRecoLabel_ << "' / '" << inputFitResultsLabel_ << "'" << std::endl;
 
         if (integrals_)
         {
             // process integral results
-            inputCollection = store.get<const dataProducts::WaveformIntegral>(inputRecoLabel_, inputFitResultsLabel_);
+            inputCollection = store.get(inputIntegrals_);
             if (inputCollection->GetEntriesFast() < 1) 
             {
                 if(debug_) std::cout << "Warning: No inputs found for xyClustering" << std::endl;
@@ -143,7 +150,7 @@ void XYPositionFinder::Process(EventStore& store, const ServiceManager& serviceM
         else 
         {
             // process fit results
-            inputCollection = store.get<const dataProducts::WaveformFit>(inputRecoLabel_, inputFitResultsLabel_);
+            inputCollection = store.get(inputFits_);
             if (inputCollection->GetEntriesFast() < 1) 
             {
                 if(debug_) std::cout << "Warning: No inputs found for xyClustering" << std::endl;
@@ -157,26 +164,23 @@ void XYPositionFinder::Process(EventStore& store, const ServiceManager& serviceM
 
         if (debug_) std::cout << "Beginning clustering process" << std::endl;
 
-        xs.clear();
-        ys.clear();
-        weights.clear();
-        energies.clear();
+        ClusterInputs in;
 
         double xi,yi,wi;
         
         thisCluster->inputs.reserve(inputCollection->GetEntriesFast());
-        xs.reserve(inputCollection->GetEntriesFast());
-        ys.reserve(inputCollection->GetEntriesFast());
-        weights.reserve(inputCollection->GetEntriesFast());
-        energies.reserve(inputCollection->GetEntriesFast());
+        in.xs.reserve(inputCollection->GetEntriesFast());
+        in.ys.reserve(inputCollection->GetEntriesFast());
+        in.weights.reserve(inputCollection->GetEntriesFast());
+        in.energies.reserve(inputCollection->GetEntriesFast());
 
         if (integrals_)
         {
-            ProcessIntegralsToXY(inputCollection, thisCluster);
+            ProcessIntegralsToXY(inputCollection, thisCluster, in);
         }
         else
         {
-            ProcessFitsToXY(inputCollection, thisCluster);
+            ProcessFitsToXY(inputCollection, thisCluster, in);
         }
 
         bool doCluster = true;
@@ -186,26 +190,26 @@ void XYPositionFinder::Process(EventStore& store, const ServiceManager& serviceM
             case 0:
                 // unit weighting
                 if (debug_) std::cout << "Weighting method " << weighting_ << " -> Unit Weighting" << std::endl;
-                for (auto ei: energies) { weights.push_back(1.0); }
+                for (auto ei: in.energies) { in.weights.push_back(1.0); }
                 break;
             case 1:
                 // energy weigting
                 if (debug_) std::cout << "Weighting method " << weighting_ << " -> Energy Weighting" << std::endl;
-                for (auto ei: energies) { weights.push_back(ei); }
+                for (auto ei: in.energies) { in.weights.push_back(ei); }
                 break;
             case 2:
                 // take highest energy
                 if (debug_) std::cout << "Weighting method " << weighting_ << " -> Picking Largest Energy" << std::endl;
-                max_ei = *std::max_element(energies.begin(), energies.end());
-                for (auto ei: energies) 
+                max_ei = *std::max_element(in.energies.begin(), in.energies.end());
+                for (auto ei: in.energies) 
                 { 
                     if (ei == max_ei)
                     {
-                        weights.push_back(1.0);
+                        in.weights.push_back(1.0);
                     }
                     else 
                     {
-                        weights.push_back(0.0);
+                        in.weights.push_back(0.0);
                     }
                 }
                 break;
@@ -213,10 +217,10 @@ void XYPositionFinder::Process(EventStore& store, const ServiceManager& serviceM
                 std::cerr<< "Weighting method '" << weighting_ << "' is not implemented" << std::endl;
                 throw;
         }
-        weightSum = std::accumulate(weights.begin(), weights.end(), 0.0);
+        in.weightSum = std::accumulate(in.weights.begin(), in.weights.end(), 0.0);
         // thisCluster.fitIndex = 
 
-        if (doCluster) Cluster(thisCluster); // only don't do this if we override somehow.
+        if (doCluster) Cluster(thisCluster, in); // only don't do this if we override somehow.
 
 
     } catch (const std::exception& e) {